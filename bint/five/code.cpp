@@ -0,0 +1,43 @@
+#include "class-bint.hpp"
+#include <iostream>
+#include <sstream>
+
+using Util::Bint;
+
+int main() {
+	// the usual loop ends cleanly at the end of the input
+	std::istringstream in("12345678901234567890123 -98765432109876543210\n0 -0 000042\n  7 8\n");
+	Bint a, b;
+	int pairs = 0;
+	while (in >> a >> b) {
+		std::cout << a + b << " " << a * b << std::endl;
+		++pairs;
+	}
+	std::cout << pairs << " " << in.eof() << std::endl;
+
+	// a bad token stops the loop with failbit, the target keeps its value
+	std::istringstream bad("5 6x 7");
+	Bint c = 1;
+	int read = 0;
+	while (bad >> c) ++read;
+	std::cout << read << " " << c << " " << bad.fail() << " " << bad.eof() << std::endl;
+	bad.clear();
+	std::string rest;
+	bad >> rest;
+	std::cout << rest << std::endl;
+
+	std::istringstream dashes("- --");
+	Bint d = 9;
+	dashes >> d;
+	std::cout << d << " " << dashes.fail() << std::endl;
+
+	// round trip through the decimal text
+	std::ostringstream out;
+	Bint big = (Bint(1) << 1000) - Bint(12345);
+	out << big << " " << -big;
+	std::istringstream back(out.str());
+	Bint x, y;
+	back >> x >> y;
+	std::cout << (x == big) << (y == -big) << std::endl;
+	return 0;
+}
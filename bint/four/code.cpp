@@ -0,0 +1,64 @@
+#include "class-bint.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using Util::Bint;
+
+// limbs of all ones, all zeros or random ones, so carries and borrows run through long stretches
+Bint random_bint(size_t limbs, int kind) {
+	Bint x = 0;
+	for (size_t i = 0; i < limbs; ++i) {
+		x <<= 64;
+		if (kind == 0 || (kind == 2 && rand() % 3 == 0)) x += (Bint(1) << 64) - Bint(1);
+		else if (kind == 1 || kind == 2) x += Bint(static_cast<long long>(rand() % 2));
+		else x += (Bint(rand()) << 33) + (Bint(rand()) << 2) + Bint(rand() % 4);
+	}
+	return x;
+}
+
+// every result the vector kernels can touch, in a form that compares across runs
+std::vector<Bint> results(const Bint &a, const Bint &b) {
+	std::vector<Bint> out;
+	out.push_back(a + b);
+	out.push_back(a - b);
+	out.push_back(b - a);
+	Bint c = a;
+	c += b;
+	c -= a;
+	out.push_back(c);
+	out.push_back(Bint((a < b) * 4 + (a == b) * 2 + (a > b)));
+	Bint d = a;
+	d += Bint(1);
+	out.push_back(Bint((d < a) * 4 + (d == a) * 2 + (d > a)));
+	return out;
+}
+
+int main() {
+	bool ok = true;
+	size_t mismatches = 0, total = 0;
+	for (size_t limbs = 1; limbs <= 40; ++limbs) {
+		for (int kind = 0; kind < 4; ++kind) {
+			Bint a = random_bint(limbs, kind), b = random_bint(limbs + rand() % 3, (kind + 1) % 4);
+			if (kind == 3) b = a - Bint(static_cast<long long>(rand() % 5)); // equal or nearly equal
+			Bint::useSimd = true;
+			std::vector<Bint> fast = results(a, b);
+			Bint::useSimd = false;
+			std::vector<Bint> slow = results(a, b);
+			Bint::useSimd = true;
+			for (size_t i = 0; i < fast.size(); ++i, ++total) {
+				if (fast[i] != slow[i]) ++mismatches;
+			}
+			ok = ok && fast[0] - b == a && fast[1] + b == a;
+		}
+	}
+	std::cout << total << " " << mismatches << " " << ok << std::endl;
+
+	// a carry out of every limb: (2^(64n) - 1) + 1 = 2^(64n)
+	for (size_t limbs : {7, 8, 9, 16, 33}) {
+		Bint ones = (Bint(1) << (64 * limbs)) - Bint(1);
+		std::cout << (ones + Bint(1) == Bint(1) << (64 * limbs)) << (ones + Bint(1) - Bint(1) == ones) << " ";
+	}
+	std::cout << std::endl;
+	return 0;
+}
@@ -0,0 +1,58 @@
+#include "class-bint.hpp"
+#include <cstdlib>
+#include <iostream>
+
+using Util::Bint;
+
+// rand() gives 31 random bits at a time
+Bint random_bint(size_t limbs) {
+	Bint x = 0;
+	for (size_t i = 0; i < (limbs * 64 + 30) / 31; ++i) {
+		x <<= 31;
+		x += Bint(rand());
+	}
+	return rand() % 5 == 0 ? -x : x;
+}
+
+// multiply with the given tiers, threads and cutoffs, the tunables are restored afterwards
+Bint product(const Bint &a, const Bint &b, size_t karatsuba, size_t ntt, size_t parallel, unsigned threads) {
+	size_t oldKaratsuba = Bint::karatsubaCutoff, oldNtt = Bint::nttCutoff, oldParallel = Bint::parallelCutoff;
+	unsigned oldThreads = Bint::threadCount;
+	Bint::karatsubaCutoff = karatsuba;
+	Bint::nttCutoff = ntt;
+	Bint::parallelCutoff = parallel;
+	Bint::threadCount = threads;
+	Bint result = a * b;
+	Bint::karatsubaCutoff = oldKaratsuba;
+	Bint::nttCutoff = oldNtt;
+	Bint::parallelCutoff = oldParallel;
+	Bint::threadCount = oldThreads;
+	return result;
+}
+
+int main() {
+	const size_t never = static_cast<size_t>(-1);
+	// the default cutoffs must leave room for the parallel Karatsuba tier
+	std::cout << (Bint::parallelCutoff < Bint::nttCutoff) << std::endl;
+
+	const Bint mod("1000000000000000000000007");
+	size_t sizes[][2] = {{40, 40}, {200, 131}, {700, 700}, {1500, 900}, {3000, 2048}};
+	for (auto &size : sizes) {
+		Bint a = random_bint(size[0]), b = random_bint(size[1]);
+		Bint expected = product(a, b, never, never, never, 1);
+		// parallel Karatsuba, every level down to 64 limbs splits into three tasks
+		Bint karatsuba = product(a, b, 16, never, 64, 4);
+		// parallel NTT with the three primes on their own threads
+		Bint ntt = product(a, b, 16, 16, 16, 4);
+		// serial NTT
+		Bint serial = product(a, b, 16, 16, never, 1);
+		std::cout << (karatsuba == expected) << " " << (ntt == expected) << " " << (serial == expected)
+			<< " " << expected % mod << std::endl;
+	}
+
+	// the default tiers, threads on
+	Bint a = random_bint(800), b = random_bint(600);
+	std::cout << (product(a, b, Bint::karatsubaCutoff, Bint::nttCutoff, Bint::parallelCutoff, 4)
+		== product(a, b, never, never, never, 1)) << std::endl;
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "class-bint.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using Util::Bint;
+
+// rand() gives 31 random bits at a time
+Bint random_bint(size_t limbs) {
+	Bint x = 0;
+	for (size_t i = 0; i < (limbs * 64 + 30) / 31; ++i) {
+		x <<= 31;
+		x += Bint(rand());
+	}
+	return rand() % 2 == 0 ? -x : x;
+}
+
+long long random_small() {
+	long long x = static_cast<long long>(rand()) << 28 ^ rand();
+	return rand() % 2 == 0 ? -x : x;
+}
+
+Bint from_int128(__int128 x) {
+	bool minus = x < 0;
+	unsigned __int128 u = minus ? -static_cast<unsigned __int128>(x) : x;
+	std::string s;
+	do {
+		s.insert(s.begin(), static_cast<char>('0' + u % 10));
+		u /= 10;
+	} while (u > 0);
+	return Bint(minus ? "-" + s : s);
+}
+
+// big values are checked through their residues, % is independent of the code under test
+const Bint P("1000000000000000000000000000057"), Q("170141183460469231731687303715884105727");
+
+Bint residue(const Bint &x, const Bint &m) {
+	return ((x % m) + m) % m;
+}
+
+bool same_residues(const Bint &x, const Bint &y) {
+	return residue(x, P) == residue(y, P) && residue(x, Q) == residue(y, Q);
+}
+
+
+int main() {
+	int wrong = 0;
+	// sums, addmul and submul on values that fit in __int128
+	for (int round = 0; round < 2000; ++round) {
+		long long a = random_small(), b = random_small(), c = random_small(), d = random_small();
+		Bint A(a), B(b), C(c), D(d);
+		Bint s = Bint::sum(A) + B - C + D;
+		wrong += !(s == from_int128(static_cast<__int128>(a) + b - c + d));
+		Bint t = C - (Bint::sum(A) - B) + (Bint::sum(D) - A);
+		wrong += !(t == from_int128(static_cast<__int128>(c) - (a - b) + (d - a)));
+		Bint u = D;
+		u += Bint::sum(A) - B + C;
+		wrong += !(u == from_int128(static_cast<__int128>(d) + a - b + c));
+		u -= Bint::sum(A) + C;
+		wrong += !(u == from_int128(static_cast<__int128>(d) - b));
+		Bint v = D;
+		v.addmul(A, B);
+		wrong += !(v == from_int128(static_cast<__int128>(a) * b + d));
+		v.submul(C, D);
+		wrong += !(v == from_int128(static_cast<__int128>(a) * b + d - static_cast<__int128>(c) * d));
+		Bint w = A;
+		w *= B;
+		wrong += !(w == from_int128(static_cast<__int128>(a) * b));
+	}
+	std::cout << "small " << wrong << std::endl;
+
+	// long chains and products across the schoolbook, Karatsuba and NTT tiers
+	wrong = 0;
+	size_t sizes[] = {1, 3, 5, 40, 300, 2500};
+	for (size_t n : sizes) {
+		Bint a = random_bint(n), b = random_bint(n / 2 + 1), c = random_bint(n), d = random_bint(1);
+		Bint s = Bint::sum(a) + b - c + d - a + c + c;
+		wrong += !same_residues(s, b + d + c);
+		wrong += !(s == b + d + c);
+		Bint x = d;
+		x.addmul(a, b);
+		wrong += !(residue(x, P) == residue(residue(a, P) * residue(b, P) + d, P));
+		wrong += !(residue(x, Q) == residue(residue(a, Q) * residue(b, Q) + d, Q));
+		x.submul(a, b);
+		wrong += !(x == d);
+		Bint y = a;
+		y *= b;
+		wrong += !(y == a * b) + !(residue(y, P) == residue(residue(a, P) * residue(b, P), P));
+	}
+	std::cout << "large " << wrong << std::endl;
+
+	// every operand the same object as the destination
+	wrong = 0;
+	for (size_t n : sizes) {
+		Bint a = random_bint(n), copy = a;
+		Bint x = a;
+		x += x;
+		wrong += !(x == copy + copy);
+		x = a;
+		x -= x;
+		wrong += !(x == 0) + (x < 0);
+		x = a;
+		x *= x;
+		wrong += !(x == copy * copy) + (x < 0);
+		x = a;
+		x.addmul(x, x);
+		wrong += !(x == copy + copy * copy);
+		x = a;
+		x.submul(x, x);
+		wrong += !(x == copy - copy * copy);
+		x = a;
+		x.addmul(x, copy);
+		wrong += !(x == copy + copy * copy);
+		x = a;
+		x = Bint::sum(x) + x - copy + x;
+		wrong += !(x == copy + copy);
+		x = a;
+		x += Bint::sum(x) + x;
+		wrong += !(x == copy + copy + copy);
+		x = a;
+		x -= Bint::sum(x) + x;
+		wrong += !(x == -copy);
+		x = a;
+		x /= x;
+		wrong += !(x == 1);
+		x = a;
+		x %= x;
+		wrong += !(x == 0);
+	}
+	std::cout << "aliased " << wrong << std::endl;
+
+	// a product that shrinks after a long one must not keep the old length
+	Bint big = random_bint(3000), one = 1;
+	big *= Bint(0);
+	big += one;
+	big *= Bint(7);
+	std::cout << big << " " << (random_bint(2000) * Bint(0)) << std::endl;
+	return 0;
+}
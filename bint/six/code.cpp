@@ -0,0 +1,101 @@
+#include "class-bint.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using Util::Bint;
+using Util::BintView;
+
+// rand() gives 31 random bits at a time
+Bint random_bint(size_t limbs) {
+	Bint x = 0;
+	for (size_t i = 0; i < (limbs * 64 + 30) / 31; ++i) {
+		x <<= 31;
+		x += Bint(rand());
+	}
+	return rand() % 2 == 0 ? -x : x;
+}
+
+// the message of the std::invalid_argument thrown for a record, or "ok"
+template<typename _Read>
+std::string error(_Read read) {
+	try {
+		read();
+	} catch (const std::invalid_argument &e) {
+		return e.what();
+	}
+	return "ok";
+}
+
+void store(std::vector<unsigned char> &buffer, size_t offset, unsigned long long x) {
+	for (int i = 0; i < 8; ++i) buffer[offset + i] = static_cast<unsigned char>(x >> (8 * i));
+}
+
+int main() {
+	// records packed back to back, zeros from every route and both signs
+	std::vector<Bint> values;
+	values.push_back(Bint(0));
+	values.push_back(Bint(-5) + Bint(5));
+	values.push_back(Bint(7) - Bint(7));
+	values.push_back(-Bint(0));
+	values.push_back(Bint(1));
+	values.push_back(Bint(-1));
+	values.push_back(Bint("18446744073709551615"));
+	values.push_back(Bint("-18446744073709551616"));
+	for (int i = 0; i < 200; ++i) values.push_back(random_bint(rand() % 40 + 1));
+	std::vector<unsigned char> buffer;
+	size_t total = 0;
+	for (const Bint &x : values) {
+		x.serialize(buffer);
+		total += x.serializedSize();
+	}
+	std::cout << (buffer.size() == total) << " " << Bint(0).serializedSize() << " "
+		<< Bint(-1).serializedSize() << std::endl;
+
+	int wrong = 0;
+	size_t offset = 0;
+	for (size_t i = 0; i < values.size(); ++i) {
+		size_t used = 0, viewed = 0;
+		Bint x = Bint::deserialize(buffer.data() + offset, buffer.size() - offset, &used);
+		BintView view(buffer.data() + offset, buffer.size() - offset, &viewed);
+		BintView live(values[i]);
+		wrong += !(x == values[i]) + (used != viewed) + (used != values[i].serializedSize());
+		wrong += !(view == live) + !(view.toBint() == values[i]) + (view.serializedSize() != used);
+		wrong += (view.isZero() != (values[i] == 0)) + (view.isNegative() != (values[i] < 0));
+		wrong += (live.limbCount() != view.limbCount()) + (view.limb(view.limbCount()) != 0);
+		if (i > 0) {
+			BintView previous(values[i - 1]);
+			wrong += ((previous < view) != (values[i - 1] < values[i])) + ((previous >= view) != (values[i - 1] >= values[i]));
+		}
+		offset += used;
+	}
+	std::cout << (offset == buffer.size()) << " " << wrong << std::endl;
+
+	// a record written in place must also read back
+	Bint big = random_bint(33);
+	std::vector<unsigned long long> aligned(big.serializedSize() / 8);
+	std::cout << (big.serialize(aligned.data()) == 8 * aligned.size()) << " "
+		<< (BintView(aligned.data(), 8 * aligned.size()).toBint() == big) << std::endl;
+
+	// damaged records
+	std::vector<unsigned char> record;
+	Bint(-123456789).serialize(record);
+	std::cout << error([&] { Bint::deserialize(record.data(), 7); }) << std::endl;
+	std::cout << error([&] { BintView(record.data(), 0); }) << std::endl;
+	std::cout << error([&] { Bint::deserialize(record.data(), 15); }) << std::endl;
+	std::cout << error([&] { BintView(record.data(), 8); }) << std::endl;
+	std::cout << error([&] { Bint::deserialize(record.data(), 16); }) << std::endl;
+	std::vector<unsigned char> limbs;
+	random_bint(4).serialize(limbs);
+	store(limbs, limbs.size() - 8, 0);
+	std::cout << error([&] { Bint::deserialize(limbs.data(), limbs.size()); }) << std::endl;
+	std::cout << error([&] { BintView(limbs.data(), limbs.size()); }) << std::endl;
+	std::vector<unsigned char> zero(8, 0);
+	store(zero, 0, 1);
+	std::cout << error([&] { Bint::deserialize(zero.data(), zero.size()); }) << std::endl;
+	std::vector<unsigned char> huge(16, 0);
+	store(huge, 0, ~0ULL);
+	std::cout << error([&] { Bint::deserialize(huge.data(), huge.size()); }) << std::endl;
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "class-bint.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+using Util::Bint;
+
+// rand() gives 31 random bits at a time
+Bint random_bint(size_t limbs) {
+	Bint x = 0;
+	for (size_t i = 0; i < (limbs * 64 + 30) / 31; ++i) {
+		x <<= 31;
+		x += Bint(rand());
+	}
+	return x;
+}
+
+// square and multiply with plain % after every step
+Bint slow_pow(Bint base, Bint exp, const Bint &mod) {
+	Bint result = 1;
+	base %= mod;
+	while (exp > Bint(0)) {
+		if (exp % Bint(2) == Bint(1)) result = result * base % mod;
+		base = base * base % mod;
+		exp >>= 1;
+	}
+	return result % mod;
+}
+
+int main() {
+	// 2^127 - 1 and 2^521 - 1 are prime, so a^(p - 1) = 1 by Fermat
+	Bint mersenne127 = (Bint(1) << 127) - Bint(1), mersenne521 = (Bint(1) << 521) - Bint(1);
+	Bint::Montgomery mont127(mersenne127), mont521(mersenne521);
+	std::cout << mont127.pow(Bint(3), mersenne127 - Bint(1)) << " "
+		<< mont521.pow(Bint(5), mersenne521 - Bint(1)) << " "
+		<< Bint::Barrett(mersenne521).pow(Bint(7), mersenne521 - Bint(1)) << std::endl;
+
+	bool ok = true;
+	for (int round = 0; round < 60; ++round) {
+		size_t limbs = 1 + rand() % 12;
+		Bint mod = random_bint(limbs) + Bint(2);
+		Bint a = random_bint(limbs + 1) % mod, b = random_bint(limbs) % mod, exp = random_bint(1 + rand() % 3);
+		Bint::Barrett barrett(mod);
+		ok = ok && barrett.reduce(a * b) == a * b % mod;
+		ok = ok && barrett.mul(a, b) == a * b % mod;
+		ok = ok && barrett.pow(a, exp) == slow_pow(a, exp, mod);
+		if (mod % Bint(2) == Bint(0)) mod += Bint(1);
+		a %= mod;
+		b %= mod;
+		Bint::Montgomery montgomery(mod);
+		ok = ok && montgomery.fromMontgomery(montgomery.toMontgomery(a)) == a;
+		ok = ok && montgomery.fromMontgomery(montgomery.mul(montgomery.toMontgomery(a), montgomery.toMontgomery(b))) == a * b % mod;
+		ok = ok && montgomery.pow(a, exp) == slow_pow(a, exp, mod);
+		ok = ok && powmod(a, exp, mod) == slow_pow(a, exp, mod);
+		if (round % 10 == 0) std::cout << powmod(a, exp, mod) % Bint(1000000007) << " ";
+	}
+	std::cout << std::endl << ok << std::endl;
+
+	// edge cases: exponent zero, modulus one, base a multiple of the modulus
+	std::cout << powmod(Bint(12345), Bint(0), Bint(1000003)) << " " << powmod(Bint(12345), Bint(77), Bint(1)) << " "
+		<< powmod(Bint(2000006), Bint(5), Bint(1000003)) << " " << powmod(Bint(-2), Bint(3), Bint(10)) << std::endl;
+	try {
+		Bint::Montgomery even(Bint(1000));
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "even modulus rejected" << std::endl;
+	}
+	try {
+		powmod(Bint(2), Bint(-1), Bint(7));
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "negative exponent rejected" << std::endl;
+	}
+	return 0;
+}
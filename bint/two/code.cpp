@@ -0,0 +1,24 @@
+#include "class-bint.hpp"
+#include <iostream>
+
+using Util::Bint;
+
+// (2^x - 3)(2^y - 1) = 2^(x + y) - 3 * 2^y - 2^x + 3
+Bint expected(size_t x, size_t y) {
+	return (Bint(1) << (x + y)) - (Bint(3) << y) - (Bint(1) << x) + Bint(3);
+}
+
+int main() {
+	Bint::threadCount = 1;
+	// 2^22 + 3 limbs times 1500 limbs needs 2^24 transform points, more than one NTT can take,
+	// so the product is assembled from chunks
+	size_t sizes[][2] = {{1500, (static_cast<size_t>(1) << 22) + 3}, {2000, 3000}};
+	for (auto &size : sizes) {
+		size_t x = 64 * size[0], y = 64 * size[1];
+		Bint a = (Bint(1) << x) - Bint(3), b = (Bint(1) << y) - Bint(1);
+		Bint product = a * b;
+		std::cout << (product == expected(x, y)) << " "
+			<< product % Bint(1000000007) << std::endl;
+	}
+	return 0;
+}
@@ -2,14 +2,37 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <cstdint>
 #include <vector>
 #include <stdexcept>
+#include <thread>
+#include <exception>
+#include <system_error>
+#if defined(__x86_64__) && defined(__GNUC__)
+#define UTIL_BINT_X86 1
+#include <immintrin.h>
+#endif
 
 namespace Util {
 
-const size_t MIN_CAPACITY = 2048;
+class BintView;
 
 class Bint {
+	friend class BintView;
+	/**
+	 * The magnitude is kept in little-endian base 2^64 limbs,
+	 * products and carries go through 128-bit integers.
+	 */
+	typedef std::uint64_t limb_t;
+	typedef unsigned __int128 dlimb_t;
+	static const int LIMB_BITS = 64;
+	/**
+	 * 10^19 is the largest power of ten in a limb,
+	 * decimal conversion works on chunks of 19 digits.
+	 */
+	static const limb_t DECIMAL_BASE = 10000000000000000000ULL;
+	static const size_t DECIMAL_DIGITS = 19;
+
 	class NewSpaceFailed : public std::runtime_error {
 	public:
 		NewSpaceFailed();
@@ -18,14 +41,143 @@ class Bint {
 	public:
 		BadCast();
 	};
+	class DivideByZero : public std::domain_error {
+	public:
+		DivideByZero();
+	};
+	/**
+	 * Numbers up to INLINE_LIMBS limbs are stored inside the object and never touch the heap,
+	 * longer ones get a block of exactly the limbs they need (rounded up to a power of two if pooled).
+	 * Limbs between length and capacity are always zero.
+	 */
+	static const size_t INLINE_LIMBS = 4;
+	static const size_t POOL_CLASSES = 17;
+	static const size_t POOL_DEPTH = 32;
 	bool isMinus = false;
-	size_t length;
-	int *data = nullptr;
-	size_t capacity = MIN_CAPACITY;
-	void _DoubleSpace();
-	void _SafeNewSpace(int *&p, const size_t &len);
+	bool pooled = false;
+	size_t length = 1;
+	limb_t *data = inlineData;
+	size_t capacity = INLINE_LIMBS;
+	limb_t inlineData[INLINE_LIMBS] = {};
+	static limb_t *_NewBlock(size_t &capa, bool &fromPool);
+	static void _FreeBlock(limb_t *p, size_t capa, bool fromPool);
+	/**
+	 * Per-thread free lists indexed by log2 of the block size, emptied when the thread exits.
+	 */
+	struct FreeLists {
+		std::vector<limb_t *> lists[POOL_CLASSES];
+		~FreeLists();
+	};
+	static std::vector<limb_t *> *_FreeLists();
+	void _Allocate(const size_t &capa);
+	void _Release();
+	void _Clear();
+	void _Reserve(const size_t &len);
+	void _Trim();
+	void _SetMagnitude(unsigned long long x);
 	explicit Bint(const size_t &capa);
+
+	/**
+	 * Kernels over raw limb arrays.
+	 * The multiplication kernels write all an + bn limbs of r.
+	 */
+	static int _CmpMag(const limb_t *a, size_t an, const limb_t *b, size_t bn);
+	static bool _EqualMag(const limb_t *a, const limb_t *b, size_t n);
+	static limb_t _AddTo(limb_t *r, size_t rn, const limb_t *a, size_t an);
+	static limb_t _SubFrom(limb_t *r, size_t rn, const limb_t *a, size_t an);
+	static void _RevSubFrom(limb_t *r, const limb_t *a, size_t an);
+
+	/**
+	 * Vector kernels, used from SIMD_MIN_LIMBS limbs on when the CPU has them.
+	 * The add and subtract kernels take a multiple of four limbs and return the carry or borrow,
+	 * the compare kernels take equal lengths.
+	 */
+	static const size_t SIMD_MIN_LIMBS = 8;
+	enum SimdLevel { SIMD_NONE, SIMD_SSE4, SIMD_AVX2 };
+	static SimdLevel _Simd();
+#ifdef UTIL_BINT_X86
+	static limb_t _AddToAVX2(limb_t *r, const limb_t *a, size_t n);
+	static limb_t _SubFromAVX2(limb_t *r, const limb_t *a, size_t n);
+	static int _CmpMagAVX2(const limb_t *a, const limb_t *b, size_t n);
+	static int _CmpMagSSE4(const limb_t *a, const limb_t *b, size_t n);
+	static bool _EqualMagAVX2(const limb_t *a, const limb_t *b, size_t n);
+#endif
+	static void _MulSchoolbook(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r);
+	static void _MulAddSchoolbook(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r, size_t rn);
+	static void _MulKaratsuba(const limb_t *a, const limb_t *b, size_t n, limb_t *r, unsigned threads = 1);
+	static void _NTT(std::vector<unsigned int> &a, bool invert, unsigned int mod, unsigned threads = 1);
+	static void _MulNTT(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r, unsigned threads = 1);
+	/**
+	 * Run f(0) .. f(threads - 1), f(0) on the calling thread and the rest on new ones.
+	 * The first exception thrown by any of them is rethrown after all have finished.
+	 */
+	template <class Function>
+	static void _Parallel(unsigned threads, Function f);
+	static void _Mul(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r);
+	static limb_t _DivSmall(limb_t *q, const limb_t *a, size_t an, limb_t d);
+	static void _DivModMag(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *q, limb_t *r);
+
+	void _AddSigned(const Bint &rhs, bool rhsMinus);
+	void _AddMul(const Bint &lhs, const Bint &rhs, bool negate);
+	static void _EvalSum(const Bint *const *terms, const bool *negate, size_t count, Bint &out);
+	static Bint _Pair(const Bint &lhs, const Bint &rhs, bool subtract);
+	static void _DivModAbs(const Bint &lhs, const Bint &rhs, Bint &q, Bint &r);
+	static Bint _DropLimbs(const Bint &x, size_t count);
+	size_t _BitLength() const;
+	template <class Context>
+	static Bint _SlidingPow(const Context &ctx, const Bint &base, const Bint &one, const Bint &exp);
+	static const Bint &_DecimalPower(size_t level, std::vector<Bint> &pow10);
+	static Bint _FromDecimal(const std::string &x, size_t begin, size_t end, std::vector<Bint> &pow10);
+	static void _ToDecimal(const Bint &x, size_t level, const std::vector<Bint> &pow10, bool pad, std::string &out);
 public:
+	/**
+	 * Size cutoffs (in limbs of the shorter operand) between the multiplication tiers:
+	 * schoolbook below karatsubaCutoff, Karatsuba below nttCutoff, NTT from there on.
+	 */
+	static size_t karatsubaCutoff;
+	static size_t nttCutoff;
+	/**
+	 * Products whose shorter operand has at least parallelCutoff limbs are split over
+	 * up to threadCount threads: the three Karatsuba sub-products run as separate tasks,
+	 * the NTT runs its three primes side by side and splits every butterfly stage.
+	 * The result does not depend on the number of threads.
+	 * Karatsuba only goes parallel while parallelCutoff is below nttCutoff.
+	 */
+	static size_t parallelCutoff;
+	static unsigned threadCount;
+	/**
+	 * Numbers up to this many limbs are converted from and to decimal digit by digit,
+	 * longer ones are split in halves around a power of ten.
+	 */
+	static size_t decimalCutoff;
+	/**
+	 * When set, heap blocks of up to 2^16 limbs are recycled through per-thread free lists
+	 * of power-of-two sizes instead of going back to the system allocator.
+	 */
+	static bool usePool;
+	/**
+	 * Use the AVX2 or SSE4.1 kernels for addition, subtraction and comparison
+	 * when the CPU supports them, clear to force the portable code.
+	 */
+	static bool useSimd;
+
+	/**
+	 * Reduction contexts for repeated arithmetic modulo one fixed positive modulus.
+	 * Barrett works for any modulus, Montgomery needs an odd one and keeps
+	 * its operands in Montgomery form (x * 2^(64n) mod m).
+	 */
+	class Barrett;
+	class Montgomery;
+	/**
+	 * A chain of + and - added in a single pass, started by Bint::sum (see the definition below).
+	 */
+	template <size_t N> class Sum;
+	/**
+	 * Start a one-pass sum: Bint::sum(a) + b - c + d adds every limb column once.
+	 * The sum only points at its operands, assign it before they go away.
+	 */
+	static Sum<1> sum(const Bint &first);
+
 	Bint();
 	Bint(int x);
 	Bint(long long x);
@@ -37,6 +189,31 @@ public:
 	Bint &operator=(long long rhs);
 	Bint &operator=(const Bint &rhs);
 	Bint &operator=(Bint &&rhs) noexcept;
+	template <size_t N> Bint &operator=(const Sum<N> &rhs);
+
+	/**
+	 * += and -= work in the existing buffer and only grow it when the result does not fit,
+	 * *= builds the product in a new block because the kernels cannot write over their inputs.
+	 */
+	Bint &operator+=(const Bint &rhs);
+	Bint &operator-=(const Bint &rhs);
+	template <size_t N> Bint &operator+=(const Sum<N> &rhs);
+	template <size_t N> Bint &operator-=(const Sum<N> &rhs);
+	Bint &operator*=(const Bint &rhs);
+	Bint &operator/=(const Bint &rhs);
+	Bint &operator%=(const Bint &rhs);
+	/**
+	 * Shifts act on the value as on a two's complement integer,
+	 * so a right shift of a negative number rounds toward negative infinity.
+	 */
+	Bint &operator<<=(size_t bits);
+	Bint &operator>>=(size_t bits);
+	/**
+	 * *this += lhs * rhs and *this -= lhs * rhs.
+	 * Short products are accumulated straight into *this without a temporary.
+	 */
+	Bint &addmul(const Bint &lhs, const Bint &rhs);
+	Bint &submul(const Bint &lhs, const Bint &rhs);
 
 	friend Bint abs(const Bint &x);
 	friend Bint abs(Bint &&x);
@@ -49,16 +226,238 @@ public:
 	friend bool operator>=(const Bint &lhs, const Bint &rhs);
 
 	friend Bint operator+(const Bint &lhs, const Bint &rhs);
+	friend Bint operator+(Bint &&lhs, const Bint &rhs);
 	friend Bint operator-(const Bint &b);
 	friend Bint operator-(Bint &&b);
 	friend Bint operator-(const Bint &lhs, const Bint &rhs);
+	friend Bint operator-(Bint &&lhs, const Bint &rhs);
 	friend Bint operator*(const Bint &lhs, const Bint &rhs);
+	friend Bint operator/(const Bint &lhs, const Bint &rhs);
+	friend Bint operator%(const Bint &lhs, const Bint &rhs);
+	friend Bint operator<<(const Bint &lhs, size_t bits);
+	friend Bint operator>>(const Bint &lhs, size_t bits);
+	/**
+	 * Truncating division as for built-in integers:
+	 * the quotient rounds toward zero and the remainder takes the sign of lhs.
+	 */
+	friend void divmod(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder);
+	/**
+	 * base^exp mod mod in [0, mod), exp must be non-negative and mod positive.
+	 */
+	friend Bint powmod(const Bint &base, const Bint &exp, const Bint &mod);
 
 	friend std::istream &operator>>(std::istream &is, Bint &b);
 	friend std::ostream &operator<<(std::ostream &os, const Bint &b);
 
+	/**
+	 * Binary format: an 8-byte little-endian header holding (limb count << 1 | sign),
+	 * followed by the limbs, least significant first, 8 little-endian bytes each.
+	 * Zero has no limbs. Every record is a multiple of 8 bytes, so records packed
+	 * back to back stay aligned for BintView.
+	 */
+	size_t serializedSize() const;
+	size_t serialize(void *buffer) const;
+	void serialize(std::vector<unsigned char> &buffer) const;
+	/**
+	 * Read one record from the front of size bytes, storing its length in *used if given.
+	 * Throws std::invalid_argument if the record is truncated or not canonical.
+	 */
+	static Bint deserialize(const void *buffer, size_t size, size_t *used = nullptr);
+
 	~Bint();
 };
+
+/**
+ * A read-only Bint that does not own its limbs, either a serialized record
+ * (in a mapped file, say) or a live Bint. The viewed memory must outlive the view.
+ * Records are read in place, so they must be 8-byte aligned and the host little-endian.
+ */
+class BintView {
+	bool minus = false;
+	size_t length = 0;
+	const std::uint64_t *limbs = nullptr;
+	static int _Compare(const BintView &lhs, const BintView &rhs);
+	static bool _Equal(const BintView &lhs, const BintView &rhs);
+public:
+	BintView() {}
+	BintView(const Bint &b);
+	/**
+	 * View the record at the front of size bytes, storing its length in *used if given.
+	 */
+	BintView(const void *buffer, size_t size, size_t *used = nullptr);
+
+	bool isNegative() const;
+	bool isZero() const;
+	size_t limbCount() const;
+	std::uint64_t limb(size_t i) const;
+	size_t serializedSize() const;
+	Bint toBint() const;
+
+	friend bool operator==(const BintView &lhs, const BintView &rhs);
+	friend bool operator!=(const BintView &lhs, const BintView &rhs);
+	friend bool operator<(const BintView &lhs, const BintView &rhs);
+	friend bool operator>(const BintView &lhs, const BintView &rhs);
+	friend bool operator<=(const BintView &lhs, const BintView &rhs);
+	friend bool operator>=(const BintView &lhs, const BintView &rhs);
+	friend std::ostream &operator<<(std::ostream &os, const BintView &b);
+};
+
+class Bint::Barrett {
+	Bint mod, mu;
+	size_t k;
+public:
+	explicit Barrett(const Bint &mod);
+	const Bint &modulus() const;
+	/**
+	 * x mod m in [0, m), fastest when 0 <= x < m^2.
+	 */
+	Bint reduce(const Bint &x) const;
+	Bint mul(const Bint &lhs, const Bint &rhs) const;
+	Bint pow(const Bint &base, const Bint &exp) const;
+};
+
+class Bint::Montgomery {
+	Bint mod, r2;
+	limb_t inv; // -m^-1 mod 2^64
+public:
+	explicit Montgomery(const Bint &mod);
+	const Bint &modulus() const;
+	Bint toMontgomery(const Bint &x) const;
+	Bint fromMontgomery(const Bint &x) const;
+	/**
+	 * lhs * rhs / 2^(64n) mod m, both operands in [0, m).
+	 */
+	Bint mul(const Bint &lhs, const Bint &rhs) const;
+	/**
+	 * base^exp mod m, taking and returning ordinary numbers.
+	 */
+	Bint pow(const Bint &base, const Bint &exp) const;
+};
+
+/**
+ * Bint::sum(a) + b - c + ... kept as a list of signed operands.
+ * Assigning it to a Bint (or converting it) adds all the operands up column by column
+ * in a single pass, without a temporary for every intermediate sum.
+ * It only points at its operands, so it must not outlive the full expression that built it;
+ * plain a + b - c returns a Bint at every step and has no such restriction.
+ */
+template <size_t N>
+class Bint::Sum {
+	template <size_t> friend class Sum;
+	friend class Bint;
+	const Bint *terms[N];
+	bool negate[N];
+
+	Sum() {}
+	Sum<N + 1> _Append(const Bint &rhs, bool subtract) const
+	{
+		Sum<N + 1> result;
+		std::copy(terms, terms + N, result.terms);
+		std::copy(negate, negate + N, result.negate);
+		result.terms[N] = &rhs;
+		result.negate[N] = subtract;
+		return result;
+	}
+	template <size_t M>
+	Sum<M + N> _AppendTo(const Sum<M> &lhs, bool subtract) const
+	{
+		Sum<M + N> result;
+		std::copy(lhs.terms, lhs.terms + M, result.terms);
+		std::copy(lhs.negate, lhs.negate + M, result.negate);
+		for (size_t i = 0; i < N; ++i) {
+			result.terms[M + i] = terms[i];
+			result.negate[M + i] = negate[i] != subtract;
+		}
+		return result;
+	}
+public:
+	operator Bint() const
+	{
+		Bint result;
+		_EvalSum(terms, negate, N, result);
+		return result;
+	}
+	friend Sum<N + 1> operator+(const Sum &lhs, const Bint &rhs)
+	{
+		return lhs._Append(rhs, false);
+	}
+	friend Sum<N + 1> operator-(const Sum &lhs, const Bint &rhs)
+	{
+		return lhs._Append(rhs, true);
+	}
+	friend Sum<N + 1> operator+(const Bint &lhs, const Sum &rhs)
+	{
+		Sum<1> head;
+		head.terms[0] = &lhs;
+		head.negate[0] = false;
+		return rhs._AppendTo(head, false);
+	}
+	friend Sum<N + 1> operator-(const Bint &lhs, const Sum &rhs)
+	{
+		Sum<1> head;
+		head.terms[0] = &lhs;
+		head.negate[0] = false;
+		return rhs._AppendTo(head, true);
+	}
+	template <size_t M>
+	Sum<N + M> operator+(const Sum<M> &rhs) const
+	{
+		return rhs._AppendTo(*this, false);
+	}
+	template <size_t M>
+	Sum<N + M> operator-(const Sum<M> &rhs) const
+	{
+		return rhs._AppendTo(*this, true);
+	}
+};
+
+inline Bint::Sum<1> Bint::sum(const Bint &first)
+{
+	Sum<1> result;
+	result.terms[0] = &first;
+	result.negate[0] = false;
+	return result;
+}
+
+inline Bint Bint::_Pair(const Bint &lhs, const Bint &rhs, bool subtract)
+{
+	const Bint *terms[2] = {&lhs, &rhs};
+	bool negate[2] = {false, subtract};
+	Bint result;
+	_EvalSum(terms, negate, 2, result);
+	return result;
+}
+
+template <size_t N>
+Bint &Bint::operator=(const Sum<N> &rhs)
+{
+	_EvalSum(rhs.terms, rhs.negate, N, *this);
+	return *this;
+}
+
+template <size_t N>
+Bint &Bint::operator+=(const Sum<N> &rhs)
+{
+	const Bint *terms[N + 1] = {this};
+	bool negate[N + 1] = {false};
+	std::copy(rhs.terms, rhs.terms + N, terms + 1);
+	std::copy(rhs.negate, rhs.negate + N, negate + 1);
+	_EvalSum(terms, negate, N + 1, *this);
+	return *this;
+}
+
+template <size_t N>
+Bint &Bint::operator-=(const Sum<N> &rhs)
+{
+	const Bint *terms[N + 1] = {this};
+	bool negate[N + 1] = {false};
+	for (size_t i = 0; i < N; ++i) {
+		terms[i + 1] = rhs.terms[i];
+		negate[i + 1] = !rhs.negate[i];
+	}
+	_EvalSum(terms, negate, N + 1, *this);
+	return *this;
+}
 }
 
 #include <iomanip>
@@ -68,161 +467,216 @@ namespace Util {
 
 Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
 Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
+Bint::DivideByZero::DivideByZero() : std::domain_error("Bint division by zero") {}
+
+size_t Bint::karatsubaCutoff = 32;
+size_t Bint::nttCutoff = 1024;
+size_t Bint::parallelCutoff = 512;
+unsigned Bint::threadCount = std::max(1u, std::thread::hardware_concurrency());
+size_t Bint::decimalCutoff = 32;
+bool Bint::usePool = false;
+bool Bint::useSimd = true;
+
+Bint::FreeLists::~FreeLists()
+{
+	for (std::vector<limb_t *> &list : lists) {
+		for (limb_t *p : list) {
+			delete[] p;
+		}
+	}
+}
+
+std::vector<Bint::limb_t *> *Bint::_FreeLists()
+{
+	static thread_local FreeLists freeLists;
+	return freeLists.lists;
+}
 
-void Bint::_SafeNewSpace(int *&p, const size_t &len)
+Bint::limb_t *Bint::_NewBlock(size_t &capa, bool &fromPool)
 {
-	if (p != nullptr) {
-		delete[] p;
-		p = nullptr;
+	fromPool = false;
+	if (usePool) {
+		size_t rounded = 1, sizeClass = 0;
+		while (rounded < capa) {
+			rounded <<= 1;
+			++sizeClass;
+		}
+		if (sizeClass < POOL_CLASSES) {
+			capa = rounded;
+			fromPool = true;
+			std::vector<limb_t *> &freeList = _FreeLists()[sizeClass];
+			if (!freeList.empty()) {
+				limb_t *p = freeList.back();
+				freeList.pop_back();
+				memset(p, 0, capa * sizeof(limb_t));
+				return p;
+			}
+		}
 	}
-	p = new int[len];
+	limb_t *p = new limb_t[capa];
 	if (p == nullptr) {
 		throw NewSpaceFailed();
 	}
-	memset(p, 0, len * sizeof(unsigned int));
+	memset(p, 0, capa * sizeof(limb_t));
+	return p;
 }
 
-void Bint::_DoubleSpace()
+void Bint::_FreeBlock(limb_t *p, size_t capa, bool fromPool)
 {
-	int *newMem = nullptr;
-	_SafeNewSpace(newMem, capacity << 1);
-	memcpy(newMem, data, capacity * sizeof(int));
-	delete[] data;
-	data = newMem;
-	capacity <<= 1;
+	if (fromPool) {
+		size_t sizeClass = __builtin_ctzll(capa);
+		std::vector<limb_t *> &freeList = _FreeLists()[sizeClass];
+		if (freeList.size() < POOL_DEPTH) {
+			freeList.push_back(p);
+			return;
+		}
+	}
+	delete[] p;
 }
 
-Bint::Bint()
-	: length(1)
+/**
+ * Discard the contents and make room for capa zero limbs.
+ */
+void Bint::_Allocate(const size_t &capa)
 {
-	_SafeNewSpace(data, capacity);
+	_Release();
+	if (capa > INLINE_LIMBS) {
+		size_t rounded = capa;
+		data = _NewBlock(rounded, pooled);
+		capacity = rounded;
+	}
 }
 
-Bint::Bint(int x)
-	: length(0)
+void Bint::_Release()
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
+	if (data != inlineData) {
+		_FreeBlock(data, capacity, pooled);
+		data = inlineData;
+		capacity = INLINE_LIMBS;
+		pooled = false;
 	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
+	memset(inlineData, 0, sizeof(inlineData));
+}
+
+/**
+ * Become an inline zero, which is also the state left behind by a move.
+ */
+void Bint::_Clear()
+{
+	_Release();
+	length = 1;
+	isMinus = false;
+}
+
+/**
+ * Keep the contents and grow to at least len limbs, at least doubling the capacity.
+ */
+void Bint::_Reserve(const size_t &len)
+{
+	if (capacity >= len) {
+		return;
 	}
-	if (!length) {
-		length = 1;
+	size_t newCapacity = std::max(len, capacity << 1);
+	bool fromPool;
+	limb_t *newMem = _NewBlock(newCapacity, fromPool);
+	memcpy(newMem, data, length * sizeof(limb_t));
+	if (data != inlineData) {
+		_FreeBlock(data, capacity, pooled);
 	}
+	data = newMem;
+	capacity = newCapacity;
+	pooled = fromPool;
 }
 
-Bint::Bint(long long x)
-	: length(0)
+void Bint::_Trim()
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
+	while (length > 1 && data[length - 1] == 0) {
+		--length;
 	}
-	if (!length) {
-		length = 1;
+	if (length == 1 && data[0] == 0) {
+		isMinus = false;
 	}
 }
 
+void Bint::_SetMagnitude(unsigned long long x)
+{
+	memset(data, 0, sizeof(limb_t) * length);
+	data[0] = x;
+	length = 1;
+}
+
+Bint::Bint() {}
+
+Bint::Bint(int x)
+	: Bint(static_cast<long long>(x)) {}
+
+Bint::Bint(long long x)
+{
+	*this = x;
+}
+
 Bint::Bint(const size_t &capa)
-	: length(1)
 {
-	while (capacity < capa) {
-		capacity <<= 1;
-	}
-	_SafeNewSpace(data, capacity);
+	_Allocate(capa);
 }
 
 Bint::Bint(std::string x)
 {
-	while (x[0] == '-') {
+	size_t begin = 0;
+	while (begin < x.length() && x[begin] == '-') {
 		isMinus = !isMinus;
-		x.erase(0, 1);
-	}
-	while ((capacity << 2) <= x.length()) {
-		capacity <<= 1;
+		++begin;
 	}
-
-	_SafeNewSpace(data, capacity);
-
-	size_t mid = x.length() >> 1;
-	for (size_t i = 0; i < mid; ++i) {
-		std::swap(x[i], x[x.length() - 1 - i]);
+	if (begin == x.length()) {
+		throw BadCast();
 	}
-
-	const static unsigned int pow10[4] = {1, 10, 100, 1000};
-	for (size_t i = 0; i < capacity; ++i) {
-		if ((i << 2) >= x.length()) {
-			length = i;
-			break;
-		}
-		for (size_t j = 0; j < 4; ++j) {
-			if ((i << 2) + j >= x.length()) {
-				break;
-			}
-			if (x[(i << 2) + j] > '9' || x[(i << 2) + j] < '0') {
-				throw BadCast();
-			}
-			data[i] = data[i] + (x[(i << 2) + j] - '0') * pow10[j];
+	for (size_t i = begin; i < x.length(); ++i) {
+		if (x[i] > '9' || x[i] < '0') {
+			throw BadCast();
 		}
 	}
+	while (begin + 1 < x.length() && x[begin] == '0') {
+		++begin;
+	}
+	std::vector<Bint> pow10;
+	Bint result = _FromDecimal(x, begin, x.length(), pow10);
+	bool minus = isMinus;
+	*this = std::move(result);
+	isMinus = minus;
+	_Trim();
 }
 
 Bint::Bint(const Bint &b)
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), length(b.length)
 {
-	_SafeNewSpace(data, capacity);
-	memcpy(data, b.data, sizeof(unsigned int) * capacity);
+	_Allocate(length);
+	memcpy(data, b.data, sizeof(limb_t) * length);
 }
 
 Bint::Bint(Bint &&b) noexcept
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), pooled(b.pooled), length(b.length)
 {
-	data = b.data;
-	b.data = nullptr;
+	if (b.data == b.inlineData) {
+		memcpy(inlineData, b.inlineData, sizeof(inlineData));
+	} else {
+		data = b.data;
+		capacity = b.capacity;
+		b.data = b.inlineData;
+		b.capacity = INLINE_LIMBS;
+		b.pooled = false;
+	}
+	b._Clear();
 }
 
 Bint &Bint::operator=(int x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
-	return *this;
+	return *this = static_cast<long long>(x);
 }
 
 Bint &Bint::operator=(long long x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	isMinus = x < 0;
+	_SetMagnitude(isMinus ? 0ULL - static_cast<unsigned long long>(x) : static_cast<unsigned long long>(x));
 	return *this;
 }
 
@@ -231,11 +685,12 @@ Bint &Bint::operator=(const Bint &rhs)
 	if (this == &rhs) {
 		return *this;
 	}
-	if (rhs.capacity > capacity) {
-		capacity = rhs.capacity;
-		_SafeNewSpace(data, capacity);
+	if (rhs.length > capacity) {
+		_Allocate(rhs.length);
+	} else if (rhs.length < length) {
+		memset(data + rhs.length, 0, sizeof(limb_t) * (length - rhs.length));
 	}
-	memcpy(data, rhs.data, sizeof(unsigned int) * rhs.capacity);
+	memcpy(data, rhs.data, sizeof(limb_t) * rhs.length);
 	length = rhs.length;
 	isMinus = rhs.isMinus;
 	return *this;
@@ -246,271 +701,1523 @@ Bint &Bint::operator=(Bint &&rhs) noexcept
 	if (this == &rhs) {
 		return *this;
 	}
-	capacity = rhs.capacity;
+	_Release();
 	length = rhs.length;
 	isMinus = rhs.isMinus;
-	data = rhs.data;
-	rhs.data = nullptr;
+	if (rhs.data == rhs.inlineData) {
+		memcpy(inlineData, rhs.inlineData, sizeof(inlineData));
+	} else {
+		data = rhs.data;
+		capacity = rhs.capacity;
+		pooled = rhs.pooled;
+		rhs.data = rhs.inlineData;
+		rhs.capacity = INLINE_LIMBS;
+		rhs.pooled = false;
+	}
+	rhs._Clear();
 	return *this;
 }
 
-std::istream &operator>>(std::istream &is, Bint &b)
+Bint::SimdLevel Bint::_Simd()
 {
-	std::string s;
-	is >> s;
-	b = Bint(s);
-	return is;
+#ifdef UTIL_BINT_X86
+	static const SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2
+		: __builtin_cpu_supports("sse4.1") ? SIMD_SSE4 : SIMD_NONE;
+	return useSimd ? level : SIMD_NONE;
+#else
+	return SIMD_NONE;
+#endif
 }
 
-std::ostream &operator<<(std::ostream &os, const Bint &b)
+int Bint::_CmpMag(const limb_t *a, size_t an, const limb_t *b, size_t bn)
 {
-	if (b.data == nullptr) {
-		return os;
+	if (an != bn) {
+		return an < bn ? -1 : 1;
 	}
-	if (b.isMinus && (b.length > 1 || b.data[0] != 0)) {
-		os << "-";
+#ifdef UTIL_BINT_X86
+	if (an >= SIMD_MIN_LIMBS) {
+		SimdLevel level = _Simd();
+		if (level == SIMD_AVX2) {
+			return _CmpMagAVX2(a, b, an);
+		}
+		if (level == SIMD_SSE4) {
+			return _CmpMagSSE4(a, b, an);
+		}
 	}
-	os << b.data[b.length - 1];
-	for (long long i = b.length - 2LL; i >= 0; --i) {
-		os << std::setw(4) << std::setfill('0') << b.data[i];
+#endif
+	for (size_t i = an; i > 0; --i) {
+		if (a[i - 1] != b[i - 1]) {
+			return a[i - 1] < b[i - 1] ? -1 : 1;
+		}
 	}
-	return os;
+	return 0;
 }
 
-Bint abs(const Bint &b)
+bool Bint::_EqualMag(const limb_t *a, const limb_t *b, size_t n)
 {
-	Bint result(b);
-	result.isMinus = false;
-	return result;
+#ifdef UTIL_BINT_X86
+	if (n >= SIMD_MIN_LIMBS && _Simd() == SIMD_AVX2) {
+		return _EqualMagAVX2(a, b, n);
+	}
+#endif
+	return memcmp(a, b, n * sizeof(limb_t)) == 0;
 }
 
-Bint abs(Bint &&b)
+Bint::limb_t Bint::_AddTo(limb_t *r, size_t rn, const limb_t *a, size_t an)
 {
-	b.isMinus = false;
-	return b;
+	limb_t carry = 0;
+	size_t i = 0;
+#ifdef UTIL_BINT_X86
+	if (an >= SIMD_MIN_LIMBS && _Simd() == SIMD_AVX2) {
+		i = an & ~static_cast<size_t>(3);
+		carry = _AddToAVX2(r, a, i);
+	}
+#endif
+	for (; i < an; ++i) {
+		limb_t sum = r[i] + carry;
+		carry = sum < carry;
+		r[i] = sum + a[i];
+		carry += r[i] < sum;
+	}
+	for (; carry && i < rn; ++i) {
+		carry = ++r[i] == 0;
+	}
+	return carry;
 }
 
-bool operator==(const Bint &lhs, const Bint &rhs)
+Bint::limb_t Bint::_SubFrom(limb_t *r, size_t rn, const limb_t *a, size_t an)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return false;
+	limb_t borrow = 0;
+	size_t i = 0;
+#ifdef UTIL_BINT_X86
+	if (an >= SIMD_MIN_LIMBS && _Simd() == SIMD_AVX2) {
+		i = an & ~static_cast<size_t>(3);
+		borrow = _SubFromAVX2(r, a, i);
 	}
-	if (lhs.length != rhs.length) {
-		return false;
+#endif
+	for (; i < an; ++i) {
+		limb_t sub = a[i] + borrow;
+		borrow = sub < borrow;
+		borrow += r[i] < sub;
+		r[i] -= sub;
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return false;
-		}
+	for (; borrow && i < rn; ++i) {
+		borrow = r[i]-- == 0;
 	}
-	return true;
+	return borrow;
 }
 
-bool operator!=(const Bint &lhs, const Bint &rhs)
+#ifdef UTIL_BINT_X86
+/**
+ * Four limbs are added lane by lane first. Each lane then either generates a carry
+ * (the sum wrapped) or propagates one (the sum is all ones). With those as 4-bit masks G and P,
+ * adding (G << 1 | carry) to P ripples the carries through the propagating lanes in one
+ * scalar addition, and the lanes that receive a carry are exactly the bits that differ from P.
+ */
+__attribute__((target("avx2")))
+Bint::limb_t Bint::_AddToAVX2(limb_t *r, const limb_t *a, size_t n)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return true;
+	const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	const __m256i lanes = _mm256_set_epi64x(8, 4, 2, 1);
+	unsigned carry = 0;
+	for (size_t i = 0; i < n; i += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(r + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i sum = _mm256_add_epi64(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi64(_mm256_xor_si256(x, bias), _mm256_xor_si256(sum, bias));
+		__m256i full = _mm256_cmpeq_epi64(sum, ones);
+		unsigned generate = _mm256_movemask_pd(_mm256_castsi256_pd(wrapped));
+		unsigned propagate = _mm256_movemask_pd(_mm256_castsi256_pd(full));
+		unsigned rippled = ((generate << 1) | carry) + propagate;
+		unsigned incoming = (rippled ^ propagate) & 15;
+		carry = rippled >> 4;
+		__m256i mask = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(incoming), lanes), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), _mm256_sub_epi64(sum, mask));
+	}
+	return carry;
+}
+
+/**
+ * The same scheme as _AddToAVX2, a lane generates a borrow when it wraps below zero
+ * and propagates one when its difference is zero.
+ */
+__attribute__((target("avx2")))
+Bint::limb_t Bint::_SubFromAVX2(limb_t *r, const limb_t *a, size_t n)
+{
+	const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lanes = _mm256_set_epi64x(8, 4, 2, 1);
+	unsigned borrow = 0;
+	for (size_t i = 0; i < n; i += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(r + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i diff = _mm256_sub_epi64(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi64(_mm256_xor_si256(y, bias), _mm256_xor_si256(x, bias));
+		__m256i empty = _mm256_cmpeq_epi64(diff, zero);
+		unsigned generate = _mm256_movemask_pd(_mm256_castsi256_pd(wrapped));
+		unsigned propagate = _mm256_movemask_pd(_mm256_castsi256_pd(empty));
+		unsigned rippled = ((generate << 1) | borrow) + propagate;
+		unsigned incoming = (rippled ^ propagate) & 15;
+		borrow = rippled >> 4;
+		__m256i mask = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(incoming), lanes), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), _mm256_add_epi64(diff, mask));
 	}
-	if (lhs.length != rhs.length) {
-		return true;
+	return borrow;
+}
+
+/**
+ * Scan down from the top four limbs at a time until a block differs,
+ * then compare the highest differing limb.
+ */
+__attribute__((target("avx2")))
+int Bint::_CmpMagAVX2(const limb_t *a, const limb_t *b, size_t n)
+{
+	size_t i = n;
+	for (; i >= 4; i -= 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i - 4));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i - 4));
+		unsigned equal = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(x, y)));
+		if (equal != 15) {
+			size_t top = i - 4 + (31 - __builtin_clz(~equal & 15));
+			return a[top] < b[top] ? -1 : 1;
+		}
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return true;
+	for (; i > 0; --i) {
+		if (a[i - 1] != b[i - 1]) {
+			return a[i - 1] < b[i - 1] ? -1 : 1;
 		}
 	}
-	return false;
+	return 0;
 }
 
-bool operator<(const Bint &lhs, const Bint &rhs)
+__attribute__((target("sse4.1")))
+int Bint::_CmpMagSSE4(const limb_t *a, const limb_t *b, size_t n)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
+	size_t i = n;
+	for (; i >= 2; i -= 2) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i - 2));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i - 2));
+		unsigned equal = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(x, y)));
+		if (equal != 3) {
+			size_t top = equal & 2 ? i - 2 : i - 1;
+			return a[top] < b[top] ? -1 : 1;
+		}
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
+	if (i == 1 && a[0] != b[0]) {
+		return a[0] < b[0] ? -1 : 1;
+	}
+	return 0;
+}
+
+__attribute__((target("avx2")))
+bool Bint::_EqualMagAVX2(const limb_t *a, const limb_t *b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		__m256i diff = _mm256_xor_si256(x, y);
+		if (!_mm256_testz_si256(diff, diff)) {
+			return false;
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+	}
+	for (; i < n; ++i) {
+		if (a[i] != b[i]) {
+			return false;
 		}
-		return false;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+	}
+	return true;
+}
+#endif
+
+void Bint::_MulSchoolbook(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r)
+{
+	std::fill(r, r + an + bn, 0);
+	for (size_t i = 0; i < an; ++i) {
+		if (a[i] == 0) {
+			continue;
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
+		dlimb_t ai = a[i];
+		limb_t carry = 0;
+		limb_t *row = r + i;
+		for (size_t j = 0; j < bn; ++j) {
+			dlimb_t t = ai * b[j] + row[j] + carry; // at most 2^128 - 1
+			row[j] = static_cast<limb_t>(t);
+			carry = static_cast<limb_t>(t >> LIMB_BITS);
 		}
-		return false;
+		row[bn] = carry;
 	}
 }
 
-bool operator>(const Bint &lhs, const Bint &rhs)
+/**
+ * r = a - r over an limbs, r must not exceed a.
+ */
+void Bint::_RevSubFrom(limb_t *r, const limb_t *a, size_t an)
 {
-	return rhs < lhs;
+	limb_t borrow = 0;
+	for (size_t i = 0; i < an; ++i) {
+		limb_t sub = r[i] + borrow;
+		borrow = sub < borrow;
+		borrow += a[i] < sub;
+		r[i] = a[i] - sub;
+	}
 }
 
-bool operator<=(const Bint &lhs, const Bint &rhs)
+/**
+ * r += a * b, the carry out of each row rippling up to r[rn - 1].
+ */
+void Bint::_MulAddSchoolbook(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r, size_t rn)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
-	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+	for (size_t i = 0; i < an; ++i) {
+		if (a[i] == 0) {
+			continue;
 		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+		dlimb_t ai = a[i];
+		limb_t carry = 0;
+		limb_t *row = r + i;
+		for (size_t j = 0; j < bn; ++j) {
+			dlimb_t t = ai * b[j] + row[j] + carry;
+			row[j] = static_cast<limb_t>(t);
+			carry = static_cast<limb_t>(t >> LIMB_BITS);
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
+		for (size_t k = i + bn; carry && k < rn; ++k) {
+			r[k] += carry;
+			carry = r[k] < carry;
 		}
-		return true;
 	}
 }
 
-bool operator>=(const Bint &lhs, const Bint &rhs)
+template <class Function>
+void Bint::_Parallel(unsigned threads, Function f)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return lhs.isMinus;
+	if (threads <= 1) {
+		f(0);
+		return;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
+	std::vector<std::exception_ptr> errors(threads);
+	auto run = [&f, &errors](unsigned id) {
+		try {
+			f(id);
+		} catch (...) {
+			errors[id] = std::current_exception();
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
+	};
+	std::vector<std::thread> workers;
+	unsigned id = 1;
+	try {
+		for (; id < threads; ++id) {
+			workers.emplace_back(run, id);
 		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
+	} catch (const std::system_error &) {
+		// out of threads, do the rest here
+		for (; id < threads; ++id) {
+			run(id);
 		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+	}
+	run(0);
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	for (std::exception_ptr &error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
 		}
-		return true;
 	}
 }
 
-
-Bint operator+(const Bint &lhs, const Bint &rhs)
+void Bint::_MulKaratsuba(const limb_t *a, const limb_t *b, size_t n, limb_t *r, unsigned threads)
 {
-	if (lhs.isMinus == rhs.isMinus) {
-		size_t maxLen = std::max(lhs.length, rhs.length);
-		size_t expectLen = maxLen + 1;
-		Bint result(expectLen); // special constructor
-		for (size_t i = 0; i < maxLen; ++i) {
-			result.data[i] = lhs.data[i] + rhs.data[i];
-		}
-		for (size_t i = 0; i < maxLen; ++i) {
-			if (result.data[i] > 10000) {
-				result.data[i] -= 10000;
-				++result.data[i + 1];
+	if (n < karatsubaCutoff || n < 4) {
+		_MulSchoolbook(a, n, b, n, r);
+		return;
+	}
+	size_t lo = n >> 1, hi = n - lo;
+	std::vector<limb_t> sa(hi + 1, 0), sb(hi + 1, 0), mid((hi + 1) << 1);
+	std::copy(a + lo, a + n, sa.begin());
+	std::copy(b + lo, b + n, sb.begin());
+	_AddTo(sa.data(), hi + 1, a, lo);
+	_AddTo(sb.data(), hi + 1, b, lo);
+	if (threads > 1 && n >= parallelCutoff) {
+		// the sub-products write disjoint ranges, each task gets a third of the threads
+		unsigned share = std::max(1u, threads / 3);
+		_Parallel(std::min(threads, 3u), [&](unsigned id) {
+			for (unsigned task = id; task < 3; task += std::min(threads, 3u)) {
+				if (task == 0) {
+					_MulKaratsuba(sa.data(), sb.data(), hi + 1, mid.data(), share);
+				} else if (task == 1) {
+					_MulKaratsuba(a, b, lo, r, share);
+				} else {
+					_MulKaratsuba(a + lo, b + lo, hi, r + (lo << 1), share);
+				}
 			}
-		}
-		result.length = result.data[maxLen] > 0 ? maxLen + 1 : maxLen;
-		result.isMinus = lhs.isMinus;
-		return result;
+		});
 	} else {
-		if (lhs.isMinus) {
-			return rhs - abs(lhs);
-		} else {
-			return lhs - abs(rhs);
-		}
+		_MulKaratsuba(a, b, lo, r);
+		_MulKaratsuba(a + lo, b + lo, hi, r + (lo << 1));
+		_MulKaratsuba(sa.data(), sb.data(), hi + 1, mid.data());
 	}
+	_SubFrom(mid.data(), mid.size(), r, lo << 1);
+	_SubFrom(mid.data(), mid.size(), r + (lo << 1), hi << 1);
+	size_t midLen = mid.size();
+	while (midLen > 0 && mid[midLen - 1] == 0) {
+		--midLen;
+	}
+	_AddTo(r + lo, (n << 1) - lo, mid.data(), midLen);
 }
 
-Bint operator-(const Bint &b)
+/**
+ * Three NTT-friendly primes, each with primitive root 3 and 2^23 | p - 1.
+ * Limbs are cut into 32-bit pieces; with at most 2^22 pieces in the shorter
+ * operand every coefficient of the convolution stays below the product of
+ * the primes (just above 2^86), so it is recovered exactly by CRT (Garner).
+ * Products needing more than 2^23 points are cut into chunks that fit.
+ */
+namespace {
+const unsigned int NTT_MOD[3] = {998244353u, 167772161u, 469762049u};
+const size_t NTT_MAX_LENGTH = static_cast<size_t>(1) << 23;
+
+unsigned int _PowMod(unsigned long long base, unsigned long long exp, unsigned int mod)
 {
-	Bint result(b);
-	result.isMinus = !result.isMinus;
-	return result;
+	unsigned long long result = 1;
+	base %= mod;
+	while (exp) {
+		if (exp & 1) {
+			result = result * base % mod;
+		}
+		base = base * base % mod;
+		exp >>= 1;
+	}
+	return static_cast<unsigned int>(result);
+}
 }
 
-Bint operator-(Bint &&b)
+/**
+ * Every stage is cut into contiguous runs of butterflies, one run per thread,
+ * as long as each run keeps at least NTT_PARALLEL_GRAIN butterflies.
+ */
+void Bint::_NTT(std::vector<unsigned int> &a, bool invert, unsigned int mod, unsigned threads)
 {
-	b.isMinus = !b.isMinus;
-	return b;
+	const size_t NTT_PARALLEL_GRAIN = static_cast<size_t>(1) << 15;
+	size_t n = a.size(), logn = __builtin_ctzll(n);
+	unsigned parts = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, (n >> 1) / NTT_PARALLEL_GRAIN)));
+	_Parallel(parts, [&](unsigned id) {
+		size_t begin = std::max<size_t>(n * id / parts, 1), end = n * (id + 1) / parts;
+		size_t j = 0; // the bit reversal of i - 1
+		for (size_t bit = 0; bit < logn; ++bit) {
+			j |= ((begin - 1) >> bit & 1) << (logn - 1 - bit);
+		}
+		for (size_t i = begin; i < end; ++i) {
+			size_t bit = n >> 1;
+			for (; j & bit; bit >>= 1) {
+				j ^= bit;
+			}
+			j ^= bit;
+			if (i < j) {
+				std::swap(a[i], a[j]);
+			}
+		}
+	});
+	std::vector<unsigned int> roots(n >> 1);
+	for (size_t len = 2; len <= n; len <<= 1) {
+		unsigned int w = _PowMod(3, (mod - 1) / len, mod);
+		if (invert) {
+			w = _PowMod(w, mod - 2, mod);
+		}
+		size_t half = len >> 1;
+		roots[0] = 1;
+		for (size_t k = 1; k < half; ++k) {
+			roots[k] = static_cast<unsigned int>(static_cast<unsigned long long>(roots[k - 1]) * w % mod);
+		}
+		_Parallel(parts, [&](unsigned id) {
+			size_t from = (n >> 1) * id / parts, to = (n >> 1) * (id + 1) / parts;
+			while (from < to) {
+				size_t block = from / half, k = from % half;
+				size_t stop = std::min(to, (block + 1) * half);
+				unsigned int *x = a.data() + block * len;
+				for (; from < stop; ++from, ++k) {
+					unsigned int u = x[k];
+					unsigned int v = static_cast<unsigned int>(static_cast<unsigned long long>(x[k + half]) * roots[k] % mod);
+					x[k] = u + v >= mod ? u + v - mod : u + v;
+					x[k + half] = u >= v ? u - v : u + mod - v;
+				}
+			}
+		});
+	}
+	if (invert) {
+		unsigned long long nInv = _PowMod(n, mod - 2, mod);
+		for (size_t i = 0; i < n; ++i) {
+			a[i] = static_cast<unsigned int>(a[i] * nInv % mod);
+		}
+	}
 }
 
-Bint operator-(const Bint &lhs, const Bint &rhs)
+void Bint::_MulNTT(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r, unsigned threads)
 {
-	if (lhs.isMinus == rhs.isMinus) {
-		if (lhs.isMinus) {
-			return -(abs(lhs) - abs(rhs));
-		} else {
-			if (lhs < rhs) {
-				return -(rhs - lhs);
+	size_t pieces = (an + bn) << 1, n = 1;
+	while (n < pieces) {
+		n <<= 1;
+	}
+	if (n > NTT_MAX_LENGTH) {
+		// too long for one transform: multiply chunk by chunk, each pair fitting in NTT_MAX_LENGTH points
+		size_t bChunk = std::min(bn, NTT_MAX_LENGTH >> 2), aChunk = (NTT_MAX_LENGTH >> 1) - bChunk;
+		std::fill(r, r + an + bn, 0);
+		std::vector<limb_t> part(aChunk + bChunk);
+		for (size_t j = 0; j < bn; j += bChunk) {
+			size_t bLen = std::min(bChunk, bn - j);
+			for (size_t i = 0; i < an; i += aChunk) {
+				size_t aLen = std::min(aChunk, an - i);
+				_MulNTT(a + i, aLen, b + j, bLen, part.data(), threads);
+				_AddTo(r + i + j, an + bn - i - j, part.data(), aLen + bLen);
 			}
-			Bint result(std::max(lhs.length, rhs.length));
-			for (size_t i = 0; i < lhs.length; ++i) {
-				result.data[i] = lhs.data[i] - rhs.data[i];
+		}
+		return;
+	}
+	std::vector<unsigned int> conv[3];
+	unsigned primeThreads = std::min(threads, 3u), share = std::max(1u, threads / 3);
+	_Parallel(primeThreads, [&](unsigned id) {
+		for (unsigned t = id; t < 3; t += primeThreads) {
+			std::vector<unsigned int> fa(n, 0), fb(n, 0);
+			for (size_t i = 0; i < an; ++i) {
+				fa[i << 1] = static_cast<unsigned int>(static_cast<std::uint32_t>(a[i]) % NTT_MOD[t]);
+				fa[i << 1 | 1] = static_cast<unsigned int>((a[i] >> 32) % NTT_MOD[t]);
 			}
-			for (size_t i = 0; i < lhs.length; ++i) {
-				if (result.data[i] < 0) {
-					result.data[i] += 10000;
-					++result.data[i + 1];
-				}
+			for (size_t i = 0; i < bn; ++i) {
+				fb[i << 1] = static_cast<unsigned int>(static_cast<std::uint32_t>(b[i]) % NTT_MOD[t]);
+				fb[i << 1 | 1] = static_cast<unsigned int>((b[i] >> 32) % NTT_MOD[t]);
 			}
-			while (result.length > 1 && result.data[result.length - 1] == 0) {
-				--result.length;
+			_NTT(fa, false, NTT_MOD[t], share);
+			_NTT(fb, false, NTT_MOD[t], share);
+			for (size_t i = 0; i < n; ++i) {
+				fa[i] = static_cast<unsigned int>(static_cast<unsigned long long>(fa[i]) * fb[i] % NTT_MOD[t]);
 			}
-			return result;
+			_NTT(fa, true, NTT_MOD[t], share);
+			conv[t].swap(fa);
 		}
-	} else {
-		return lhs + (-rhs);
+	});
+	const unsigned long long m0 = NTT_MOD[0], m1 = NTT_MOD[1], m2 = NTT_MOD[2];
+	const unsigned long long inv01 = _PowMod(m0, m1 - 2, m1);
+	const unsigned long long inv012 = _PowMod(m0 * m1 % m2, m2 - 2, m2);
+	// every thread recombines a run of whole limbs with its own carry,
+	// the carries out of the runs are added back in order afterwards
+	size_t limbs = an + bn;
+	unsigned parts = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, limbs / parallelCutoff)));
+	std::vector<dlimb_t> carries(parts, 0);
+	_Parallel(parts, [&](unsigned id) {
+		size_t from = limbs * id / parts * 2, to = limbs * (id + 1) / parts * 2;
+		dlimb_t carry = 0;
+		for (size_t i = from; i < to; ++i) {
+			unsigned long long r0 = conv[0][i], r1 = conv[1][i], r2 = conv[2][i];
+			unsigned long long k1 = (r1 + m1 - r0 % m1) % m1 * inv01 % m1;
+			unsigned long long x01 = r0 + m0 * k1; // below m0 * m1 < 2^58
+			unsigned long long k2 = (r2 + m2 - x01 % m2) % m2 * inv012 % m2;
+			carry += x01 + static_cast<dlimb_t>(m0 * m1) * k2;
+			limb_t piece = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+			if (i & 1) {
+				r[i >> 1] |= piece << 32;
+			} else {
+				r[i >> 1] = piece;
+			}
+		}
+		carries[id] = carry;
+	});
+	for (unsigned id = 0; id + 1 < parts; ++id) {
+		size_t offset = limbs * (id + 1) / parts;
+		limb_t carry[2] = {static_cast<limb_t>(carries[id]), static_cast<limb_t>(carries[id] >> LIMB_BITS)};
+		_AddTo(r + offset, limbs - offset, carry, std::min<size_t>(2, limbs - offset));
 	}
 }
 
-Bint operator*(const Bint &lhs, const Bint &rhs)
+void Bint::_Mul(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *r)
 {
-	size_t expectLen = lhs.length + rhs.length + 2;
-	Bint result(expectLen);
-	for (size_t i = 0; i < lhs.length; ++i) {
-		for (size_t j = 0; j < rhs.length; ++j) {
-			long long tmp = result.data[i + j] + static_cast<long long>(lhs.data[i]) * rhs.data[j];
-			if (tmp >= 10000) {
-				result.data[i + j] = tmp % 10000;
-				result.data[i + j + 1] += static_cast<int>(tmp / 10000);
-			} else {
-				result.data[i + j] = tmp;
+	if (an < bn) {
+		std::swap(a, b);
+		std::swap(an, bn);
+	}
+	if (bn < karatsubaCutoff) {
+		_MulSchoolbook(a, an, b, bn, r);
+		return;
+	}
+	unsigned threads = bn >= parallelCutoff ? std::max(1u, threadCount) : 1;
+	if (bn >= nttCutoff) {
+		_MulNTT(a, an, b, bn, r, threads);
+		return;
+	}
+	// cut the longer operand into chunks as long as the shorter one
+	std::fill(r, r + an + bn, 0);
+	std::vector<limb_t> chunk(bn), part(bn << 1);
+	for (size_t offset = 0; offset < an; offset += bn) {
+		size_t len = std::min(bn, an - offset);
+		std::fill(chunk.begin(), chunk.end(), 0);
+		std::copy(a + offset, a + offset + len, chunk.begin());
+		_MulKaratsuba(chunk.data(), b, bn, part.data(), threads);
+		_AddTo(r + offset, an + bn - offset, part.data(), std::min(part.size(), an + bn - offset));
+	}
+}
+
+Bint::limb_t Bint::_DivSmall(limb_t *q, const limb_t *a, size_t an, limb_t d)
+{
+	dlimb_t rem = 0;
+	for (size_t i = an; i > 0; --i) {
+		rem = rem << LIMB_BITS | a[i - 1];
+		q[i - 1] = static_cast<limb_t>(rem / d);
+		rem %= d;
+	}
+	return static_cast<limb_t>(rem);
+}
+
+/**
+ * Knuth's algorithm D. q receives an - bn + 1 limbs and r receives bn limbs,
+ * b[bn - 1] must not be zero and an >= bn.
+ */
+void Bint::_DivModMag(const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *q, limb_t *r)
+{
+	if (bn == 1) {
+		r[0] = _DivSmall(q, a, an, b[0]);
+		return;
+	}
+	int shift = __builtin_clzll(b[bn - 1]);
+	std::vector<limb_t> u(an + 1), v(bn);
+	for (size_t i = bn; i > 0; --i) {
+		v[i - 1] = b[i - 1] << shift | (shift && i > 1 ? b[i - 2] >> (LIMB_BITS - shift) : 0);
+	}
+	u[an] = shift ? a[an - 1] >> (LIMB_BITS - shift) : 0;
+	for (size_t i = an; i > 0; --i) {
+		u[i - 1] = a[i - 1] << shift | (shift && i > 1 ? a[i - 2] >> (LIMB_BITS - shift) : 0);
+	}
+	const dlimb_t base = static_cast<dlimb_t>(1) << LIMB_BITS;
+	for (size_t j = an - bn + 1; j > 0; --j) {
+		limb_t *window = u.data() + j - 1;
+		dlimb_t top = static_cast<dlimb_t>(window[bn]) << LIMB_BITS | window[bn - 1];
+		dlimb_t qhat = top / v[bn - 1];
+		dlimb_t rhat = top % v[bn - 1];
+		while (qhat >= base || qhat * v[bn - 2] > (rhat << LIMB_BITS | window[bn - 2])) {
+			--qhat;
+			rhat += v[bn - 1];
+			if (rhat >= base) {
+				break;
 			}
 		}
+		// window -= qhat * v
+		limb_t carry = 0, borrow = 0;
+		for (size_t i = 0; i < bn; ++i) {
+			dlimb_t product = qhat * v[i] + carry;
+			carry = static_cast<limb_t>(product >> LIMB_BITS);
+			limb_t low = static_cast<limb_t>(product);
+			limb_t diff = window[i] - low - borrow;
+			borrow = window[i] < low || (window[i] == low && borrow);
+			window[i] = diff;
+		}
+		limb_t last = window[bn];
+		window[bn] = last - carry - borrow;
+		if (last < carry || (last == carry && borrow)) {
+			--qhat;
+			window[bn] += _AddTo(window, bn, v.data(), bn);
+		}
+		q[j - 1] = static_cast<limb_t>(qhat);
 	}
-	result.length = lhs.length + rhs.length -1;
-	while (result.data[result.length] > 0) {
-		++result.length;
+	for (size_t i = 0; i < bn; ++i) {
+		r[i] = u[i] >> shift | (shift ? u[i + 1] << (LIMB_BITS - shift) : 0);
 	}
-	while (result.length > 1 && result.data[result.length - 1] == 0) {
-		--result.length;
+}
+
+/**
+ * *this += rhs with the sign of rhs taken as rhsMinus, in place.
+ */
+void Bint::_AddSigned(const Bint &rhs, bool rhsMinus)
+{
+	size_t rhsLength = rhs.length;
+	if (rhsLength == 1 && rhs.data[0] == 0) {
+		return;
 	}
-	return result;
+	if (isMinus == rhsMinus || (length == 1 && data[0] == 0)) {
+		size_t len = std::max(length, rhsLength) + 1;
+		_Reserve(len);
+		_AddTo(data, len, rhs.data, rhsLength);
+		length = len;
+		isMinus = rhsMinus;
+	} else if (_CmpMag(data, length, rhs.data, rhsLength) >= 0) {
+		_SubFrom(data, length, rhs.data, rhsLength);
+	} else {
+		_Reserve(rhsLength);
+		_RevSubFrom(data, rhs.data, rhsLength);
+		length = rhsLength;
+		isMinus = rhsMinus;
+	}
+	_Trim();
+}
+
+void Bint::_AddMul(const Bint &lhs, const Bint &rhs, bool negate)
+{
+	if ((lhs.length == 1 && lhs.data[0] == 0) || (rhs.length == 1 && rhs.data[0] == 0)) {
+		return;
+	}
+	bool productMinus = (lhs.isMinus != rhs.isMinus) != negate;
+	bool sameSign = isMinus == productMinus || (length == 1 && data[0] == 0);
+	if (sameSign && std::min(lhs.length, rhs.length) < karatsubaCutoff && this != &lhs && this != &rhs) {
+		size_t len = std::max(length, lhs.length + rhs.length) + 1;
+		_Reserve(len);
+		_MulAddSchoolbook(lhs.data, lhs.length, rhs.data, rhs.length, data, len);
+		length = len;
+		isMinus = productMinus;
+		_Trim();
+		return;
+	}
+	Bint product = lhs * rhs;
+	_AddSigned(product, productMinus);
+}
+
+/**
+ * out = sum of (negate[k] ? -1 : 1) * terms[k], out may be one of the terms.
+ * Each column of limbs is summed into a signed 128-bit accumulator whose upper half
+ * carries into the next column, a negative total comes out in two's complement.
+ */
+void Bint::_EvalSum(const Bint *const *terms, const bool *negate, size_t count, Bint &out)
+{
+	if (count == 2) {
+		// a plain a + b or a - b goes through the add and subtract kernels
+		const Bint &lhs = *terms[0], &rhs = *terms[1];
+		if (&out == &rhs && &out != &lhs) {
+			out.isMinus = out.isMinus != negate[1];
+			out._Trim();
+			out._AddSigned(lhs, lhs.isMinus != negate[0]);
+			return;
+		}
+		if (&out != &lhs) {
+			size_t len = std::max(lhs.length, rhs.length) + 1;
+			if (out.capacity < len) {
+				out._Allocate(len);
+			}
+			out = lhs;
+		}
+		out.isMinus = out.isMinus != negate[0];
+		out._Trim();
+		out._AddSigned(rhs, rhs.isMinus != negate[1]);
+		return;
+	}
+	size_t len = 0;
+	bool aliased = false;
+	for (size_t k = 0; k < count; ++k) {
+		len = std::max(len, terms[k]->length);
+		aliased = aliased || terms[k] == &out;
+	}
+	++len;
+	size_t oldLength = out.length;
+	if (aliased) {
+		out._Reserve(len);
+	} else if (out.capacity < len) {
+		out._Allocate(len);
+	}
+	__int128 acc = 0;
+	for (size_t i = 0; i < len; ++i) {
+		for (size_t k = 0; k < count; ++k) {
+			const Bint &term = *terms[k];
+			if (i < term.length) {
+				if (negate[k] != term.isMinus) {
+					acc -= term.data[i];
+				} else {
+					acc += term.data[i];
+				}
+			}
+		}
+		out.data[i] = static_cast<limb_t>(acc);
+		acc >>= LIMB_BITS;
+	}
+	for (size_t i = len; i < oldLength; ++i) {
+		out.data[i] = 0;
+	}
+	out.length = len;
+	out.isMinus = acc < 0;
+	if (out.isMinus) {
+		limb_t carry = 1;
+		for (size_t i = 0; i < len; ++i) {
+			out.data[i] = ~out.data[i] + carry;
+			carry = carry && out.data[i] == 0;
+		}
+	}
+	out._Trim();
+}
+
+void Bint::_DivModAbs(const Bint &lhs, const Bint &rhs, Bint &q, Bint &r)
+{
+	if (_CmpMag(lhs.data, lhs.length, rhs.data, rhs.length) < 0) {
+		q = 0;
+		r = lhs;
+		r.isMinus = false;
+		return;
+	}
+	Bint quotient(lhs.length - rhs.length + 1), remainder(rhs.length);
+	_DivModMag(lhs.data, lhs.length, rhs.data, rhs.length, quotient.data, remainder.data);
+	quotient.length = lhs.length - rhs.length + 1;
+	remainder.length = rhs.length;
+	quotient._Trim();
+	remainder._Trim();
+	q = std::move(quotient);
+	r = std::move(remainder);
+}
+
+/**
+ * pow10[k] holds 10^(19 * 2^k), filled on demand.
+ */
+const Bint &Bint::_DecimalPower(size_t level, std::vector<Bint> &pow10)
+{
+	while (pow10.size() <= level) {
+		if (pow10.empty()) {
+			Bint base;
+			base.data[0] = DECIMAL_BASE;
+			pow10.push_back(std::move(base));
+		} else {
+			pow10.push_back(pow10.back() * pow10.back());
+		}
+	}
+	return pow10[level];
+}
+
+/**
+ * A long decimal string is split so that its lower part has 19 * 2^k digits,
+ * the halves are converted on their own and joined by one multiplication.
+ */
+Bint Bint::_FromDecimal(const std::string &x, size_t begin, size_t end, std::vector<Bint> &pow10)
+{
+	if (end - begin <= std::max(decimalCutoff, static_cast<size_t>(1)) * DECIMAL_DIGITS) {
+		Bint result((end - begin) / DECIMAL_DIGITS + 1);
+		size_t len = 1;
+		size_t head = (end - begin) % DECIMAL_DIGITS;
+		for (size_t pos = begin; pos < end; ) {
+			size_t chunkLen = pos == begin && head != 0 ? head : DECIMAL_DIGITS;
+			limb_t chunk = 0, scale = 1;
+			for (size_t i = 0; i < chunkLen; ++i, ++pos) {
+				chunk = chunk * 10 + (x[pos] - '0');
+				scale *= 10;
+			}
+			limb_t carry = chunk;
+			for (size_t i = 0; i < len; ++i) {
+				dlimb_t t = static_cast<dlimb_t>(result.data[i]) * scale + carry;
+				result.data[i] = static_cast<limb_t>(t);
+				carry = static_cast<limb_t>(t >> LIMB_BITS);
+			}
+			if (carry) {
+				result.data[len++] = carry;
+			}
+		}
+		result.length = len;
+		result._Trim();
+		return result;
+	}
+	size_t level = 0;
+	while ((DECIMAL_DIGITS << (level + 1)) < end - begin) {
+		++level;
+	}
+	size_t mid = end - (DECIMAL_DIGITS << level);
+	Bint high = _FromDecimal(x, begin, mid, pow10);
+	return high * _DecimalPower(level, pow10) + _FromDecimal(x, mid, end, pow10);
+}
+
+/**
+ * Append the digits of x < 10^(19 * 2^(level + 1)) to out, padded to full width if pad.
+ */
+void Bint::_ToDecimal(const Bint &x, size_t level, const std::vector<Bint> &pow10, bool pad, std::string &out)
+{
+	size_t width = DECIMAL_DIGITS << (level + 1);
+	if (x.length <= decimalCutoff || level == 0) {
+		std::vector<limb_t> rest(x.data, x.data + x.length), chunks;
+		size_t len = x.length;
+		while (len > 1 || rest[0] != 0) {
+			chunks.push_back(_DivSmall(rest.data(), rest.data(), len, DECIMAL_BASE));
+			while (len > 1 && rest[len - 1] == 0) {
+				--len;
+			}
+		}
+		std::string digits;
+		for (size_t i = chunks.size(); i > 0; --i) {
+			std::string chunk = std::to_string(chunks[i - 1]);
+			if (i != chunks.size()) {
+				digits.append(DECIMAL_DIGITS - chunk.length(), '0');
+			}
+			digits += chunk;
+		}
+		if (digits.empty()) {
+			digits = "0";
+		}
+		if (pad && digits.length() < width) {
+			out.append(width - digits.length(), '0');
+		}
+		out += digits;
+		return;
+	}
+	Bint q, r;
+	_DivModAbs(x, pow10[level], q, r);
+	if (!pad && q.length == 1 && q.data[0] == 0) {
+		_ToDecimal(r, level - 1, pow10, false, out);
+		return;
+	}
+	_ToDecimal(q, level - 1, pow10, pad, out);
+	_ToDecimal(r, level - 1, pow10, true, out);
+}
+
+/**
+ * b is left alone when nothing is read, a token that is not a number sets failbit.
+ */
+std::istream &operator>>(std::istream &is, Bint &b)
+{
+	std::string s;
+	if (is >> s) {
+		try {
+			b = Bint(s);
+		} catch (const Bint::BadCast &) {
+			is.setstate(std::ios::failbit);
+		}
+	}
+	return is;
+}
+
+std::ostream &operator<<(std::ostream &os, const Bint &b)
+{
+	// pick the top level so that |b| < pow10[level]^2
+	std::vector<Bint> pow10;
+	size_t level = 0;
+	while (Bint::_DecimalPower(level, pow10).length * 2 < b.length + 2) {
+		++level;
+	}
+	std::string out;
+	if (b.isMinus) {
+		out = "-";
+	}
+	Bint::_ToDecimal(abs(b), level, pow10, false, out);
+	return os << out;
+}
+
+Bint abs(const Bint &b)
+{
+	Bint result(b);
+	result.isMinus = false;
+	return result;
+}
+
+Bint abs(Bint &&b)
+{
+	b.isMinus = false;
+	return std::move(b);
+}
+
+bool operator==(const Bint &lhs, const Bint &rhs)
+{
+	return lhs.isMinus == rhs.isMinus && lhs.length == rhs.length && Bint::_EqualMag(lhs.data, rhs.data, lhs.length);
+}
+
+bool operator!=(const Bint &lhs, const Bint &rhs)
+{
+	return !(lhs == rhs);
+}
+
+bool operator<(const Bint &lhs, const Bint &rhs)
+{
+	if (lhs.isMinus != rhs.isMinus) {
+		return lhs.isMinus;
+	}
+	int cmp = Bint::_CmpMag(lhs.data, lhs.length, rhs.data, rhs.length);
+	return lhs.isMinus ? cmp > 0 : cmp < 0;
+}
+
+bool operator>(const Bint &lhs, const Bint &rhs)
+{
+	return rhs < lhs;
+}
+
+bool operator<=(const Bint &lhs, const Bint &rhs)
+{
+	return !(rhs < lhs);
+}
+
+bool operator>=(const Bint &lhs, const Bint &rhs)
+{
+	return !(lhs < rhs);
+}
+
+Bint operator+(const Bint &lhs, const Bint &rhs)
+{
+	return Bint::_Pair(lhs, rhs, false);
+}
+
+Bint operator+(Bint &&lhs, const Bint &rhs)
+{
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+Bint operator-(const Bint &b)
+{
+	Bint result(b);
+	result.isMinus = !result.isMinus;
+	result._Trim();
+	return result;
+}
+
+Bint operator-(Bint &&b)
+{
+	b.isMinus = !b.isMinus;
+	b._Trim();
+	return std::move(b);
+}
+
+Bint operator-(const Bint &lhs, const Bint &rhs)
+{
+	return Bint::_Pair(lhs, rhs, true);
+}
+
+Bint operator-(Bint &&lhs, const Bint &rhs)
+{
+	lhs -= rhs;
+	return std::move(lhs);
+}
+
+Bint &Bint::operator+=(const Bint &rhs)
+{
+	_AddSigned(rhs, rhs.isMinus);
+	return *this;
+}
+
+Bint &Bint::operator-=(const Bint &rhs)
+{
+	_AddSigned(rhs, !rhs.isMinus);
+	return *this;
+}
+
+Bint &Bint::operator*=(const Bint &rhs)
+{
+	return *this = *this * rhs;
+}
+
+Bint &Bint::operator/=(const Bint &rhs)
+{
+	return *this = *this / rhs;
+}
+
+Bint &Bint::operator%=(const Bint &rhs)
+{
+	return *this = *this % rhs;
+}
+
+Bint &Bint::operator<<=(size_t bits)
+{
+	if (length == 1 && data[0] == 0) {
+		return *this;
+	}
+	size_t limbs = bits / LIMB_BITS, shift = bits % LIMB_BITS;
+	size_t len = length + limbs + 1;
+	_Reserve(len);
+	for (size_t i = length + 1; i > 0; --i) {
+		limb_t high = i - 1 < length ? data[i - 1] << shift : 0;
+		limb_t low = shift && i >= 2 ? data[i - 2] >> (LIMB_BITS - shift) : 0;
+		data[i - 1 + limbs] = high | low;
+	}
+	std::fill(data, data + limbs, 0);
+	length = len;
+	_Trim();
+	return *this;
+}
+
+Bint &Bint::operator>>=(size_t bits)
+{
+	size_t limbs = bits / LIMB_BITS, shift = bits % LIMB_BITS;
+	bool minus = isMinus;
+	if (limbs >= length) {
+		return *this = minus ? -1LL : 0LL;
+	}
+	bool lost = false;
+	if (minus) {
+		for (size_t i = 0; i < limbs && !lost; ++i) {
+			lost = data[i] != 0;
+		}
+		lost = lost || (shift && (data[limbs] & ((static_cast<limb_t>(1) << shift) - 1)));
+	}
+	size_t len = length - limbs;
+	for (size_t i = 0; i < len; ++i) {
+		limb_t high = shift && i + limbs + 1 < length ? data[i + limbs + 1] << (LIMB_BITS - shift) : 0;
+		data[i] = data[i + limbs] >> shift | high;
+	}
+	std::fill(data + len, data + length, 0);
+	length = len;
+	if (lost) {
+		const limb_t one = 1;
+		_Reserve(length + 1);
+		_AddTo(data, length + 1, &one, 1);
+		++length;
+	}
+	isMinus = minus;
+	_Trim();
+	return *this;
+}
+
+Bint &Bint::addmul(const Bint &lhs, const Bint &rhs)
+{
+	_AddMul(lhs, rhs, false);
+	return *this;
+}
+
+Bint &Bint::submul(const Bint &lhs, const Bint &rhs)
+{
+	_AddMul(lhs, rhs, true);
+	return *this;
+}
+
+Bint operator<<(const Bint &lhs, size_t bits)
+{
+	Bint result(lhs);
+	result <<= bits;
+	return result;
+}
+
+Bint operator>>(const Bint &lhs, size_t bits)
+{
+	Bint result(lhs);
+	result >>= bits;
+	return result;
+}
+
+Bint operator*(const Bint &lhs, const Bint &rhs)
+{
+	size_t expectLen = lhs.length + rhs.length;
+	Bint result(expectLen);
+	Bint::_Mul(lhs.data, lhs.length, rhs.data, rhs.length, result.data);
+	result.length = expectLen;
+	result.isMinus = lhs.isMinus != rhs.isMinus;
+	result._Trim();
+	return result;
+}
+
+void divmod(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder)
+{
+	if (rhs.length == 1 && rhs.data[0] == 0) {
+		throw Bint::DivideByZero();
+	}
+	Bint q, r;
+	Bint::_DivModAbs(lhs, rhs, q, r);
+	q.isMinus = lhs.isMinus != rhs.isMinus;
+	r.isMinus = lhs.isMinus;
+	q._Trim();
+	r._Trim();
+	quotient = std::move(q);
+	remainder = std::move(r);
+}
+
+Bint operator/(const Bint &lhs, const Bint &rhs)
+{
+	Bint q, r;
+	divmod(lhs, rhs, q, r);
+	return q;
+}
+
+Bint operator%(const Bint &lhs, const Bint &rhs)
+{
+	Bint q, r;
+	divmod(lhs, rhs, q, r);
+	return r;
+}
+
+Bint Bint::_DropLimbs(const Bint &x, size_t count)
+{
+	if (count >= x.length) {
+		return Bint();
+	}
+	Bint result(x.length - count);
+	memcpy(result.data, x.data + count, sizeof(limb_t) * (x.length - count));
+	result.length = x.length - count;
+	return result;
+}
+
+size_t Bint::_BitLength() const
+{
+	if (length == 1 && data[0] == 0) {
+		return 0;
+	}
+	return length * LIMB_BITS - __builtin_clzll(data[length - 1]);
+}
+
+/**
+ * Left-to-right sliding window exponentiation, base and one already in the form ctx.mul expects.
+ * Only the odd powers base^1, base^3, ... below 2^window are precomputed.
+ */
+template <class Context>
+Bint Bint::_SlidingPow(const Context &ctx, const Bint &base, const Bint &one, const Bint &exp)
+{
+	size_t bits = exp._BitLength();
+	if (bits == 0) {
+		return one;
+	}
+	size_t window = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : bits > 7 ? 2 : 1;
+	auto bit = [&exp](size_t i) {
+		return exp.data[i / LIMB_BITS] >> (i % LIMB_BITS) & 1;
+	};
+	std::vector<Bint> odd(static_cast<size_t>(1) << (window - 1));
+	odd[0] = base;
+	if (odd.size() > 1) {
+		Bint square = ctx.mul(base, base);
+		for (size_t i = 1; i < odd.size(); ++i) {
+			odd[i] = ctx.mul(odd[i - 1], square);
+		}
+	}
+	Bint result = one;
+	bool started = false;
+	for (size_t end = bits; end > 0; ) {
+		if (!bit(end - 1)) {
+			if (started) {
+				result = ctx.mul(result, result);
+			}
+			--end;
+			continue;
+		}
+		size_t begin = end >= window ? end - window : 0;
+		while (!bit(begin)) {
+			++begin;
+		}
+		size_t value = 0;
+		for (size_t i = end; i > begin; --i) {
+			value = value << 1 | bit(i - 1);
+			if (started) {
+				result = ctx.mul(result, result);
+			}
+		}
+		result = started ? ctx.mul(result, odd[value >> 1]) : odd[value >> 1];
+		started = true;
+		end = begin;
+	}
+	return result;
+}
+
+Bint::Barrett::Barrett(const Bint &m)
+	: mod(m), k(m.length)
+{
+	if (m.isMinus || (m.length == 1 && m.data[0] == 0)) {
+		throw std::invalid_argument("Bint modulus must be positive");
+	}
+	// mu = floor(2^(128k) / m)
+	Bint power(2 * k + 1);
+	power.data[2 * k] = 1;
+	power.length = 2 * k + 1;
+	mu = power / mod;
+}
+
+const Bint &Bint::Barrett::modulus() const
+{
+	return mod;
+}
+
+Bint Bint::Barrett::reduce(const Bint &x) const
+{
+	if (x.isMinus || x.length > 2 * k) {
+		Bint r = x % mod;
+		return r.isMinus ? r + mod : r;
+	}
+	Bint estimate = _DropLimbs(_DropLimbs(x, k - 1) * mu, k + 1);
+	Bint r = x - estimate * mod;
+	while (r >= mod) {
+		r = r - mod;
+	}
+	return r;
+}
+
+Bint Bint::Barrett::mul(const Bint &lhs, const Bint &rhs) const
+{
+	return reduce(lhs * rhs);
+}
+
+Bint Bint::Barrett::pow(const Bint &base, const Bint &exp) const
+{
+	if (exp.isMinus) {
+		throw std::invalid_argument("Bint exponent must be non-negative");
+	}
+	return _SlidingPow(*this, reduce(base), reduce(Bint(1)), exp);
+}
+
+Bint::Montgomery::Montgomery(const Bint &m)
+	: mod(m)
+{
+	if (m.isMinus || (m.data[0] & 1) == 0) {
+		throw std::invalid_argument("Montgomery modulus must be positive and odd");
+	}
+	// Newton iteration, each step doubles the number of correct low bits
+	limb_t x = m.data[0];
+	for (int i = 0; i < 6; ++i) {
+		x *= 2 - m.data[0] * x;
+	}
+	inv = 0 - x;
+	Bint power(2 * m.length + 1);
+	power.data[2 * m.length] = 1;
+	power.length = 2 * m.length + 1;
+	r2 = power % mod;
+}
+
+const Bint &Bint::Montgomery::modulus() const
+{
+	return mod;
+}
+
+Bint Bint::Montgomery::toMontgomery(const Bint &x) const
+{
+	Bint r = x % mod;
+	if (r.isMinus) {
+		r = r + mod;
+	}
+	return mul(r, r2);
+}
+
+Bint Bint::Montgomery::fromMontgomery(const Bint &x) const
+{
+	return mul(x, Bint(1));
+}
+
+Bint Bint::Montgomery::mul(const Bint &lhs, const Bint &rhs) const
+{
+	// coarsely integrated operand scanning, t < 2m after every outer step
+	size_t n = mod.length;
+	const limb_t *m = mod.data;
+	std::vector<limb_t> a(n, 0), b(n, 0), t(n + 2, 0);
+	std::copy(lhs.data, lhs.data + std::min(lhs.length, n), a.begin());
+	std::copy(rhs.data, rhs.data + std::min(rhs.length, n), b.begin());
+	for (size_t i = 0; i < n; ++i) {
+		limb_t carry = 0;
+		for (size_t j = 0; j < n; ++j) {
+			dlimb_t s = static_cast<dlimb_t>(a[i]) * b[j] + t[j] + carry;
+			t[j] = static_cast<limb_t>(s);
+			carry = static_cast<limb_t>(s >> LIMB_BITS);
+		}
+		dlimb_t s = static_cast<dlimb_t>(t[n]) + carry;
+		t[n] = static_cast<limb_t>(s);
+		t[n + 1] = static_cast<limb_t>(s >> LIMB_BITS);
+		limb_t q = t[0] * inv;
+		s = static_cast<dlimb_t>(q) * m[0] + t[0];
+		carry = static_cast<limb_t>(s >> LIMB_BITS);
+		for (size_t j = 1; j < n; ++j) {
+			s = static_cast<dlimb_t>(q) * m[j] + t[j] + carry;
+			t[j - 1] = static_cast<limb_t>(s);
+			carry = static_cast<limb_t>(s >> LIMB_BITS);
+		}
+		s = static_cast<dlimb_t>(t[n]) + carry;
+		t[n - 1] = static_cast<limb_t>(s);
+		t[n] = t[n + 1] + static_cast<limb_t>(s >> LIMB_BITS);
+	}
+	Bint result(n + 1);
+	memcpy(result.data, t.data(), sizeof(limb_t) * (n + 1));
+	result.length = n + 1;
+	result._Trim();
+	if (_CmpMag(result.data, result.length, m, n) >= 0) {
+		_SubFrom(result.data, result.length, m, n);
+		result._Trim();
+	}
+	return result;
+}
+
+Bint Bint::Montgomery::pow(const Bint &base, const Bint &exp) const
+{
+	if (exp.isMinus) {
+		throw std::invalid_argument("Bint exponent must be non-negative");
+	}
+	return fromMontgomery(_SlidingPow(*this, toMontgomery(base), toMontgomery(Bint(1)), exp));
+}
+
+Bint powmod(const Bint &base, const Bint &exp, const Bint &mod)
+{
+	if (mod.data[0] & 1) {
+		return Bint::Montgomery(mod).pow(base, exp);
+	}
+	return Bint::Barrett(mod).pow(base, exp);
+}
+
+namespace {
+void _StoreLE(unsigned char *p, std::uint64_t x)
+{
+	for (int i = 0; i < 8; ++i) {
+		p[i] = static_cast<unsigned char>(x >> (8 * i));
+	}
+}
+
+std::uint64_t _LoadLE(const unsigned char *p)
+{
+	std::uint64_t x = 0;
+	for (int i = 0; i < 8; ++i) {
+		x |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+	}
+	return x;
+}
+
+const bool HOST_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+/**
+ * Check the header at the front of size bytes, return the limb count and sign.
+ */
+size_t _ReadHeader(const unsigned char *p, size_t size, bool &minus)
+{
+	if (size < 8) {
+		throw std::invalid_argument("Truncated Bint record");
+	}
+	std::uint64_t header = _LoadLE(p);
+	std::uint64_t count = header >> 1;
+	minus = header & 1;
+	if (count > (size - 8) / 8) {
+		throw std::invalid_argument("Truncated Bint record");
+	}
+	if (count == 0 ? minus : _LoadLE(p + 8 * count) == 0) {
+		throw std::invalid_argument("Bint record is not canonical");
+	}
+	return static_cast<size_t>(count);
+}
+}
+
+size_t Bint::serializedSize() const
+{
+	bool zero = length == 1 && data[0] == 0;
+	return 8 + (zero ? 0 : 8 * length);
+}
+
+size_t Bint::serialize(void *buffer) const
+{
+	unsigned char *p = static_cast<unsigned char *>(buffer);
+	size_t count = length == 1 && data[0] == 0 ? 0 : length;
+	_StoreLE(p, static_cast<std::uint64_t>(count) << 1 | (isMinus ? 1 : 0));
+	if (HOST_LITTLE_ENDIAN) {
+		memcpy(p + 8, data, 8 * count);
+	} else {
+		for (size_t i = 0; i < count; ++i) {
+			_StoreLE(p + 8 * (i + 1), data[i]);
+		}
+	}
+	return 8 + 8 * count;
+}
+
+void Bint::serialize(std::vector<unsigned char> &buffer) const
+{
+	size_t offset = buffer.size();
+	buffer.resize(offset + serializedSize());
+	serialize(buffer.data() + offset);
+}
+
+Bint Bint::deserialize(const void *buffer, size_t size, size_t *used)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(buffer);
+	bool minus;
+	size_t count = _ReadHeader(p, size, minus);
+	Bint result(count);
+	if (HOST_LITTLE_ENDIAN) {
+		memcpy(result.data, p + 8, 8 * count);
+	} else {
+		for (size_t i = 0; i < count; ++i) {
+			result.data[i] = _LoadLE(p + 8 * (i + 1));
+		}
+	}
+	result.length = count == 0 ? 1 : count;
+	result.isMinus = minus;
+	if (used != nullptr) {
+		*used = 8 + 8 * count;
+	}
+	return result;
+}
+
+BintView::BintView(const Bint &b)
+	: minus(b.isMinus), length(b.length == 1 && b.data[0] == 0 ? 0 : b.length), limbs(b.data) {}
+
+BintView::BintView(const void *buffer, size_t size, size_t *used)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(buffer);
+	if (!HOST_LITTLE_ENDIAN || reinterpret_cast<std::uintptr_t>(p) % alignof(std::uint64_t) != 0) {
+		throw std::invalid_argument("BintView needs 8-byte aligned records on a little-endian host");
+	}
+	length = _ReadHeader(p, size, minus);
+	limbs = reinterpret_cast<const std::uint64_t *>(p + 8);
+	if (used != nullptr) {
+		*used = 8 + 8 * length;
+	}
+}
+
+bool BintView::isNegative() const
+{
+	return minus;
+}
+
+bool BintView::isZero() const
+{
+	return length == 0;
+}
+
+size_t BintView::limbCount() const
+{
+	return length;
+}
+
+std::uint64_t BintView::limb(size_t i) const
+{
+	return i < length ? limbs[i] : 0;
+}
+
+size_t BintView::serializedSize() const
+{
+	return 8 + 8 * length;
+}
+
+Bint BintView::toBint() const
+{
+	Bint result(length);
+	memcpy(result.data, limbs, 8 * length);
+	result.length = length == 0 ? 1 : length;
+	result.isMinus = minus;
+	return result;
+}
+
+int BintView::_Compare(const BintView &lhs, const BintView &rhs)
+{
+	if (lhs.minus != rhs.minus) {
+		return lhs.minus ? -1 : 1;
+	}
+	int cmp = lhs.length == 0 && rhs.length == 0 ? 0 : Bint::_CmpMag(lhs.limbs, lhs.length, rhs.limbs, rhs.length);
+	return lhs.minus ? -cmp : cmp;
+}
+
+bool BintView::_Equal(const BintView &lhs, const BintView &rhs)
+{
+	return lhs.minus == rhs.minus && lhs.length == rhs.length
+		&& (lhs.length == 0 || Bint::_EqualMag(lhs.limbs, rhs.limbs, lhs.length));
+}
+
+bool operator==(const BintView &lhs, const BintView &rhs)
+{
+	return BintView::_Equal(lhs, rhs);
+}
+
+bool operator!=(const BintView &lhs, const BintView &rhs)
+{
+	return !(lhs == rhs);
+}
+
+bool operator<(const BintView &lhs, const BintView &rhs)
+{
+	return BintView::_Compare(lhs, rhs) < 0;
+}
+
+bool operator>(const BintView &lhs, const BintView &rhs)
+{
+	return BintView::_Compare(lhs, rhs) > 0;
+}
+
+bool operator<=(const BintView &lhs, const BintView &rhs)
+{
+	return BintView::_Compare(lhs, rhs) <= 0;
+}
+
+bool operator>=(const BintView &lhs, const BintView &rhs)
+{
+	return BintView::_Compare(lhs, rhs) >= 0;
+}
+
+std::ostream &operator<<(std::ostream &os, const BintView &b)
+{
+	return os << b.toBint();
 }
 
 Bint::~Bint()
 {
-	if (data != nullptr) {
-		delete[] data;
-		data = nullptr;
+	if (data != inlineData) {
+		_FreeBlock(data, capacity, pooled);
 	}
 }
 }
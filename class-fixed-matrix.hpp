@@ -0,0 +1,421 @@
+#ifndef DIAMOND_FIXED_MATRIX_HPP
+#define DIAMOND_FIXED_MATRIX_HPP
+
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include "class-matrix.hpp"
+
+namespace Diamond {
+
+/**
+ * An R x C matrix whose size is part of its type, for the small matrices of geometry code.
+ * The elements live inside the object, nothing is allocated, every loop has a constant
+ * trip count and is unrolled, and all operations are constexpr.
+ * The storage is a built-in array: writing through std::array is not constexpr before C++17.
+ */
+template<typename _Td, size_t R, size_t C>
+class FixedMatrix {
+	_Td elements[R][C];
+public:
+	typedef _Td value_type;
+
+	constexpr FixedMatrix() : elements{} {}
+	constexpr explicit FixedMatrix(const _Td &fillValue) : elements{}
+	{
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			elements[k / C][k % C] = fillValue;
+		}
+	}
+	/**
+	 * The elements row by row, missing ones are zero.
+	 */
+	constexpr FixedMatrix(std::initializer_list<_Td> list) : elements{}
+	{
+		if (list.size() > R * C) {
+			throw std::invalid_argument("too many elements for the matrix");
+		}
+		size_t k = 0;
+		for (const _Td &value : list) {
+			elements[k / C][k % C] = value;
+			++k;
+		}
+	}
+	explicit FixedMatrix(const Matrix<_Td> &mat) : elements{}
+	{
+		if (mat.RowSize() != R || mat.ColSize() != C) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		for (size_t i = 0; i < R; ++i) {
+			for (size_t j = 0; j < C; ++j) {
+				elements[i][j] = mat[i][j];
+			}
+		}
+	}
+	static constexpr size_t RowSize()
+	{
+		return R;
+	}
+	static constexpr size_t ColSize()
+	{
+		return C;
+	}
+	constexpr const _Td & At(const size_t &i, const size_t &j) const
+	{
+		return elements[i][j];
+	}
+	constexpr _Td * operator[](const size_t &Kth)
+	{
+		return elements[Kth];
+	}
+	constexpr const _Td * operator[](const size_t &Kth) const
+	{
+		return elements[Kth];
+	}
+	MatrixView<const _Td> View() const
+	{
+		return MatrixView<const _Td>(elements[0], R, C, C);
+	}
+	Matrix<_Td> ToMatrix() const
+	{
+		return Matrix<_Td>(View());
+	}
+	static constexpr FixedMatrix Identity()
+	{
+		static_assert(R == C, "the identity is square");
+		FixedMatrix result;
+#pragma GCC unroll 16
+		for (size_t i = 0; i < R; ++i) {
+			result.elements[i][i] = static_cast<_Td>(1);
+		}
+		return result;
+	}
+
+	constexpr FixedMatrix & operator+=(const FixedMatrix &other)
+	{
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			elements[k / C][k % C] += other.elements[k / C][k % C];
+		}
+		return *this;
+	}
+	constexpr FixedMatrix & operator-=(const FixedMatrix &other)
+	{
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			elements[k / C][k % C] -= other.elements[k / C][k % C];
+		}
+		return *this;
+	}
+	constexpr FixedMatrix & operator*=(const _Td &value)
+	{
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			elements[k / C][k % C] *= value;
+		}
+		return *this;
+	}
+	constexpr FixedMatrix & operator/=(const _Td &value)
+	{
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			elements[k / C][k % C] /= value;
+		}
+		return *this;
+	}
+	friend constexpr FixedMatrix operator+(FixedMatrix a, const FixedMatrix &b)
+	{
+		return a += b;
+	}
+	friend constexpr FixedMatrix operator-(FixedMatrix a, const FixedMatrix &b)
+	{
+		return a -= b;
+	}
+	friend constexpr FixedMatrix operator-(const FixedMatrix &a)
+	{
+		FixedMatrix result;
+		return result -= a;
+	}
+	friend constexpr FixedMatrix operator*(FixedMatrix a, const _Td &value)
+	{
+		return a *= value;
+	}
+	friend constexpr FixedMatrix operator*(const _Td &value, FixedMatrix a)
+	{
+		return a *= value;
+	}
+	friend constexpr FixedMatrix operator/(FixedMatrix a, const _Td &value)
+	{
+		return a /= value;
+	}
+	friend constexpr bool operator==(const FixedMatrix &a, const FixedMatrix &b)
+	{
+		for (size_t k = 0; k < R * C; ++k) {
+			if (a.elements[k / C][k % C] != b.elements[k / C][k % C]) {
+				return false;
+			}
+		}
+		return true;
+	}
+	friend constexpr bool operator!=(const FixedMatrix &a, const FixedMatrix &b)
+	{
+		return !(a == b);
+	}
+	friend constexpr FixedMatrix<_Td, C, R> Transpose(const FixedMatrix &a)
+	{
+		FixedMatrix<_Td, C, R> result;
+#pragma GCC unroll 16
+		for (size_t k = 0; k < R * C; ++k) {
+			result[k % C][k / C] = a.elements[k / C][k % C];
+		}
+		return result;
+	}
+	/**
+	 * Row i of the product is a sum of rows of b, so the innermost loop runs along
+	 * contiguous rows and vectorises.
+	 */
+	template<size_t N>
+	friend constexpr FixedMatrix<_Td, R, N> operator*(const FixedMatrix &a, const FixedMatrix<_Td, C, N> &b)
+	{
+		FixedMatrix<_Td, R, N> result;
+#pragma GCC unroll 16
+		for (size_t i = 0; i < R; ++i) {
+#pragma GCC unroll 16
+			for (size_t p = 0; p < C; ++p) {
+				const _Td x = a.elements[i][p];
+#pragma GCC unroll 16
+				for (size_t j = 0; j < N; ++j) {
+					result[i][j] += x * b[p][j];
+				}
+			}
+		}
+		return result;
+	}
+	friend constexpr _Td Trace(const FixedMatrix &a)
+	{
+		static_assert(R == C, "the trace needs a square matrix");
+		_Td result = static_cast<_Td>(0);
+		for (size_t i = 0; i < R; ++i) {
+			result += a.elements[i][i];
+		}
+		return result;
+	}
+};
+
+/**
+ * Determinant and inverse: closed forms up to 4 x 4, Gauss-Jordan with partial pivoting above.
+ */
+template<typename _Td, size_t N>
+struct _FixedSquare {
+	static constexpr _Td Abs(const _Td &x)
+	{
+		return x < static_cast<_Td>(0) ? -x : x;
+	}
+	static constexpr _Td Determinant(FixedMatrix<_Td, N, N> a)
+	{
+		static_assert(std::is_floating_point<_Td>::value, "elimination needs a floating-point type");
+		_Td result = static_cast<_Td>(1);
+		for (size_t j = 0; j < N; ++j) {
+			size_t pivot = j;
+			for (size_t i = j + 1; i < N; ++i) {
+				if (Abs(a[i][j]) > Abs(a[pivot][j])) {
+					pivot = i;
+				}
+			}
+			if (a[pivot][j] == static_cast<_Td>(0)) {
+				return static_cast<_Td>(0);
+			}
+			if (pivot != j) {
+				for (size_t c = 0; c < N; ++c) {
+					_Td t = a[j][c];
+					a[j][c] = a[pivot][c];
+					a[pivot][c] = t;
+				}
+				result = -result;
+			}
+			result *= a[j][j];
+			for (size_t i = j + 1; i < N; ++i) {
+				const _Td f = a[i][j] / a[j][j];
+				for (size_t c = j; c < N; ++c) {
+					a[i][c] -= f * a[j][c];
+				}
+			}
+		}
+		return result;
+	}
+	static constexpr FixedMatrix<_Td, N, N> Inverse(FixedMatrix<_Td, N, N> a)
+	{
+		static_assert(std::is_floating_point<_Td>::value, "elimination needs a floating-point type");
+		FixedMatrix<_Td, N, N> b = FixedMatrix<_Td, N, N>::Identity();
+		for (size_t j = 0; j < N; ++j) {
+			size_t pivot = j;
+			for (size_t i = j + 1; i < N; ++i) {
+				if (Abs(a[i][j]) > Abs(a[pivot][j])) {
+					pivot = i;
+				}
+			}
+			if (a[pivot][j] == static_cast<_Td>(0)) {
+				throw std::invalid_argument("the matrix is singular");
+			}
+			for (size_t c = 0; c < N; ++c) {
+				_Td t = a[j][c];
+				a[j][c] = a[pivot][c];
+				a[pivot][c] = t;
+				t = b[j][c];
+				b[j][c] = b[pivot][c];
+				b[pivot][c] = t;
+			}
+			const _Td inverse = static_cast<_Td>(1) / a[j][j];
+			for (size_t c = 0; c < N; ++c) {
+				a[j][c] *= inverse;
+				b[j][c] *= inverse;
+			}
+			for (size_t i = 0; i < N; ++i) {
+				if (i == j) {
+					continue;
+				}
+				const _Td f = a[i][j];
+				for (size_t c = 0; c < N; ++c) {
+					a[i][c] -= f * a[j][c];
+					b[i][c] -= f * b[j][c];
+				}
+			}
+		}
+		return b;
+	}
+};
+
+template<typename _Td>
+struct _FixedSquare<_Td, 1> {
+	static constexpr _Td Determinant(const FixedMatrix<_Td, 1, 1> &a)
+	{
+		return a[0][0];
+	}
+	static constexpr FixedMatrix<_Td, 1, 1> Inverse(const FixedMatrix<_Td, 1, 1> &a)
+	{
+		if (a[0][0] == static_cast<_Td>(0)) {
+			throw std::invalid_argument("the matrix is singular");
+		}
+		return FixedMatrix<_Td, 1, 1>{static_cast<_Td>(1) / a[0][0]};
+	}
+};
+
+template<typename _Td>
+struct _FixedSquare<_Td, 2> {
+	static constexpr _Td Determinant(const FixedMatrix<_Td, 2, 2> &a)
+	{
+		return a[0][0] * a[1][1] - a[0][1] * a[1][0];
+	}
+	static constexpr FixedMatrix<_Td, 2, 2> Inverse(const FixedMatrix<_Td, 2, 2> &a)
+	{
+		const _Td det = Determinant(a);
+		if (det == static_cast<_Td>(0)) {
+			throw std::invalid_argument("the matrix is singular");
+		}
+		return FixedMatrix<_Td, 2, 2>{a[1][1], -a[0][1], -a[1][0], a[0][0]} * (static_cast<_Td>(1) / det);
+	}
+};
+
+template<typename _Td>
+struct _FixedSquare<_Td, 3> {
+	static constexpr FixedMatrix<_Td, 3, 3> Adjugate(const FixedMatrix<_Td, 3, 3> &a)
+	{
+		return FixedMatrix<_Td, 3, 3>{
+			a[1][1] * a[2][2] - a[1][2] * a[2][1], a[0][2] * a[2][1] - a[0][1] * a[2][2], a[0][1] * a[1][2] - a[0][2] * a[1][1],
+			a[1][2] * a[2][0] - a[1][0] * a[2][2], a[0][0] * a[2][2] - a[0][2] * a[2][0], a[0][2] * a[1][0] - a[0][0] * a[1][2],
+			a[1][0] * a[2][1] - a[1][1] * a[2][0], a[0][1] * a[2][0] - a[0][0] * a[2][1], a[0][0] * a[1][1] - a[0][1] * a[1][0]};
+	}
+	static constexpr _Td Determinant(const FixedMatrix<_Td, 3, 3> &a)
+	{
+		return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+			- a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+			+ a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	}
+	static constexpr FixedMatrix<_Td, 3, 3> Inverse(const FixedMatrix<_Td, 3, 3> &a)
+	{
+		const FixedMatrix<_Td, 3, 3> adj = Adjugate(a);
+		const _Td det = a[0][0] * adj[0][0] + a[0][1] * adj[1][0] + a[0][2] * adj[2][0];
+		if (det == static_cast<_Td>(0)) {
+			throw std::invalid_argument("the matrix is singular");
+		}
+		return adj * (static_cast<_Td>(1) / det);
+	}
+};
+
+/**
+ * 4 x 4 by Laplace expansion along the first two rows: the twelve 2 x 2 minors are shared
+ * between the determinant and every cofactor.
+ */
+template<typename _Td>
+struct _FixedSquare<_Td, 4> {
+	static constexpr _Td Determinant(const FixedMatrix<_Td, 4, 4> &a)
+	{
+		const _Td s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		const _Td s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		const _Td s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		const _Td s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		const _Td s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		const _Td s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+		const _Td c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		const _Td c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		const _Td c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		const _Td c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		const _Td c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		const _Td c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+		return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	}
+	static constexpr FixedMatrix<_Td, 4, 4> Inverse(const FixedMatrix<_Td, 4, 4> &a)
+	{
+		const _Td s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		const _Td s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		const _Td s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		const _Td s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		const _Td s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		const _Td s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+		const _Td c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		const _Td c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		const _Td c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		const _Td c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		const _Td c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		const _Td c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+		const _Td det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (det == static_cast<_Td>(0)) {
+			throw std::invalid_argument("the matrix is singular");
+		}
+		FixedMatrix<_Td, 4, 4> result;
+		result[0][0] = a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3;
+		result[0][1] = -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3;
+		result[0][2] = a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3;
+		result[0][3] = -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3;
+		result[1][0] = -a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1;
+		result[1][1] = a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1;
+		result[1][2] = -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1;
+		result[1][3] = a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1;
+		result[2][0] = a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0;
+		result[2][1] = -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0;
+		result[2][2] = a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0;
+		result[2][3] = -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0;
+		result[3][0] = -a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0;
+		result[3][1] = a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0;
+		result[3][2] = -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0;
+		result[3][3] = a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0;
+		return result *= static_cast<_Td>(1) / det;
+	}
+};
+
+template<typename _Td, size_t N>
+constexpr _Td Determinant(const FixedMatrix<_Td, N, N> &a)
+{
+	return _FixedSquare<_Td, N>::Determinant(a);
+}
+
+template<typename _Td, size_t N>
+constexpr FixedMatrix<_Td, N, N> Inverse(const FixedMatrix<_Td, N, N> &a)
+{
+	static_assert(std::is_floating_point<_Td>::value, "the inverse needs a floating-point type");
+	return _FixedSquare<_Td, N>::Inverse(a);
+}
+
+}
+#endif
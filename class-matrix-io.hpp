@@ -0,0 +1,313 @@
+#ifndef DIAMOND_MATRIX_IO_HPP
+#define DIAMOND_MATRIX_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include "class-matrix.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DIAMOND_MATRIX_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Diamond {
+
+/**
+ * The binary matrix file: this 64-byte header, then rows x stride elements exactly as
+ * they lie in a Matrix, padding included, so every row starts on a 64-byte boundary
+ * of the file and a mapped file can be viewed in place.
+ */
+struct MatrixFileHeader {
+	char magic[8];
+	std::uint32_t version;
+	/**
+	 * 0x01020304 as the saving machine stores it, a file from a machine with the other
+	 * byte order is refused.
+	 */
+	std::uint32_t byteOrder;
+	std::uint32_t type;
+	std::uint32_t elementSize;
+	std::uint64_t rows;
+	std::uint64_t cols;
+	std::uint64_t stride;
+	std::uint64_t alignment;
+	char reserved[8];
+};
+
+static_assert(sizeof(MatrixFileHeader) == MATRIX_ALIGNMENT, "the header must keep the rows aligned");
+
+const char MATRIX_FILE_MAGIC[8] = {'D', 'M', 'A', 'T', 'R', 'I', 'X', '\0'};
+const std::uint32_t MATRIX_FILE_VERSION = 1;
+
+/**
+ * The element type tag: unsigned, signed or floating in the high byte, the size in the low one.
+ */
+template<typename _Td>
+std::uint32_t _MatrixFileType()
+{
+	static_assert(std::is_arithmetic<_Td>::value, "only arithmetic elements can be saved");
+	std::uint32_t kind = std::is_floating_point<_Td>::value ? 3 : std::is_signed<_Td>::value ? 2 : 1;
+	return kind << 8 | static_cast<std::uint32_t>(sizeof(_Td));
+}
+
+template<typename _Td>
+size_t _MatrixFileStride(const size_t &cols)
+{
+	if (MATRIX_ALIGNMENT % sizeof(_Td) != 0) {
+		return cols;
+	}
+	size_t perLine = MATRIX_ALIGNMENT / sizeof(_Td);
+	return (cols + perLine - 1) / perLine * perLine;
+}
+
+template<typename _Td>
+MatrixFileHeader _MatrixFileHeader(const size_t &rows, const size_t &cols)
+{
+	MatrixFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+	header.version = MATRIX_FILE_VERSION;
+	header.byteOrder = 0x01020304;
+	header.type = _MatrixFileType<_Td>();
+	header.elementSize = sizeof(_Td);
+	header.rows = rows;
+	header.cols = cols;
+	header.stride = _MatrixFileStride<_Td>(cols);
+	header.alignment = MATRIX_ALIGNMENT;
+	return header;
+}
+
+/**
+ * Throws unless the header describes a matrix of _Td that this build can read,
+ * including a size in bytes that fits in a size_t.
+ */
+template<typename _Td>
+void _CheckMatrixFileHeader(const MatrixFileHeader &header)
+{
+	if (std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+		throw std::invalid_argument("not a matrix file");
+	}
+	if (header.version != MATRIX_FILE_VERSION || header.byteOrder != 0x01020304) {
+		throw std::invalid_argument("the matrix file has another version or byte order");
+	}
+	if (header.type != _MatrixFileType<_Td>() || header.elementSize != sizeof(_Td)) {
+		throw std::invalid_argument("the matrix file holds another element type");
+	}
+	if (header.stride < header.cols) {
+		throw std::invalid_argument("the matrix file is corrupted");
+	}
+	const std::uint64_t limit = std::numeric_limits<size_t>::max() - MATRIX_ALIGNMENT;
+	if (header.stride > limit || (header.stride != 0 && header.rows > limit / header.stride / sizeof(_Td))) {
+		throw std::invalid_argument("the matrix file is corrupted");
+	}
+}
+
+/**
+ * Write the view row by row with zeroed padding, a view may not own the elements
+ * between its rows.
+ */
+template<typename _Td>
+void Save(const MatrixView<const _Td> &view, std::ostream &stream)
+{
+	MatrixFileHeader header = _MatrixFileHeader<_Td>(view.RowSize(), view.ColSize());
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	std::vector<_Td> row(header.stride, static_cast<_Td>(0));
+	for (size_t i = 0; i < view.RowSize(); ++i) {
+		std::copy(view[i], view[i] + view.ColSize(), row.begin());
+		stream.write(reinterpret_cast<const char *>(row.data()), row.size() * sizeof(_Td));
+	}
+	if (!stream) {
+		throw std::runtime_error("cannot write the matrix");
+	}
+}
+
+/**
+ * Write the matrix in the binary format, one write for the whole storage when its
+ * rows are laid out as in the file.
+ */
+template<typename _Td>
+void Save(const Matrix<_Td> &mat, std::ostream &stream)
+{
+	if (mat.Stride() != _MatrixFileStride<_Td>(mat.ColSize())) {
+		Save(mat.View(), stream);
+		return;
+	}
+	MatrixFileHeader header = _MatrixFileHeader<_Td>(mat.RowSize(), mat.ColSize());
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char *>(mat.Data()), mat.RowSize() * mat.Stride() * sizeof(_Td));
+	if (!stream) {
+		throw std::runtime_error("cannot write the matrix");
+	}
+}
+
+template<typename _Td>
+void Save(const Matrix<_Td> &mat, const std::string &path)
+{
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream) {
+		throw std::runtime_error("cannot open " + path);
+	}
+	Save(mat, stream);
+}
+
+template<typename _Td>
+Matrix<_Td> Load(std::istream &stream)
+{
+	MatrixFileHeader header;
+	if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+		throw std::invalid_argument("not a matrix file");
+	}
+	_CheckMatrixFileHeader<_Td>(header);
+	// on a seekable stream a truncated or damaged file is refused before anything is allocated
+	std::istream::pos_type begin = stream.tellg();
+	if (begin != std::istream::pos_type(-1) && stream.seekg(0, std::ios::end)) {
+		std::uint64_t remaining = static_cast<std::uint64_t>(stream.tellg() - begin);
+		stream.seekg(begin);
+		if (header.stride != 0 && remaining / sizeof(_Td) / header.stride < header.rows) {
+			throw std::invalid_argument("the matrix file is truncated");
+		}
+	}
+	stream.clear();
+	Matrix<_Td> result(header.rows, header.cols);
+	if (result.Stride() == header.stride) {
+		stream.read(reinterpret_cast<char *>(result.Data()), result.RowSize() * result.Stride() * sizeof(_Td));
+	} else {
+		std::vector<_Td> row(header.stride);
+		for (size_t i = 0; i < result.RowSize() && stream; ++i) {
+			stream.read(reinterpret_cast<char *>(row.data()), row.size() * sizeof(_Td));
+			std::copy(row.begin(), row.begin() + result.ColSize(), result[i]);
+		}
+	}
+	if (!stream) {
+		throw std::invalid_argument("the matrix file is truncated");
+	}
+	return result;
+}
+
+template<typename _Td>
+Matrix<_Td> Load(const std::string &path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream) {
+		throw std::runtime_error("cannot open " + path);
+	}
+	return Load<_Td>(stream);
+}
+
+#ifdef DIAMOND_MATRIX_MMAP
+/**
+ * A matrix file mapped read-only. Opening costs one mmap whatever the size, pages are
+ * read on first touch and can be dropped by the kernel under memory pressure.
+ * Views taken from it are invalidated when it is destroyed.
+ */
+template<typename _Td>
+class MappedMatrix {
+	void *address = nullptr;
+	size_t length = 0;
+	MatrixView<const _Td> view;
+
+	void _Unmap()
+	{
+		if (address != nullptr) {
+			munmap(address, length);
+			address = nullptr;
+			length = 0;
+		}
+	}
+public:
+	MappedMatrix() {}
+	explicit MappedMatrix(const std::string &path)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("cannot open " + path);
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+			close(fd);
+			throw std::invalid_argument("not a matrix file");
+		}
+		length = info.st_size;
+		address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (address == MAP_FAILED) {
+			address = nullptr;
+			throw std::runtime_error("cannot map " + path);
+		}
+		try {
+			MatrixFileHeader header;
+			std::memcpy(&header, address, sizeof(header));
+			_CheckMatrixFileHeader<_Td>(header);
+			if (header.alignment % alignof(_Td) != 0
+				|| (header.stride != 0 && (length - sizeof(header)) / sizeof(_Td) / header.stride < header.rows)) {
+				throw std::invalid_argument("the matrix file is truncated");
+			}
+			const _Td *base = reinterpret_cast<const _Td *>(static_cast<const char *>(address) + sizeof(header));
+			view = MatrixView<const _Td>(base, header.rows, header.cols, header.stride);
+		} catch (...) {
+			_Unmap();
+			throw;
+		}
+	}
+	MappedMatrix(const MappedMatrix &) = delete;
+	MappedMatrix & operator=(const MappedMatrix &) = delete;
+	MappedMatrix(MappedMatrix &&other) noexcept
+		: address(other.address), length(other.length), view(other.view)
+	{
+		other.address = nullptr;
+		other.length = 0;
+		other.view = MatrixView<const _Td>();
+	}
+	MappedMatrix & operator=(MappedMatrix &&other) noexcept
+	{
+		if (this != &other) {
+			_Unmap();
+			std::swap(address, other.address);
+			std::swap(length, other.length);
+			std::swap(view, other.view);
+		}
+		return *this;
+	}
+	~MappedMatrix()
+	{
+		_Unmap();
+	}
+	inline size_t RowSize() const
+	{
+		return view.RowSize();
+	}
+	inline size_t ColSize() const
+	{
+		return view.ColSize();
+	}
+	inline const _Td * operator[](const size_t &Kth) const
+	{
+		return view[Kth];
+	}
+	inline MatrixView<const _Td> View() const
+	{
+		return view;
+	}
+	/**
+	 * Tell the kernel how the mapping will be read, e.g. MADV_SEQUENTIAL before a full scan
+	 * or MADV_WILLNEED to start reading ahead.
+	 */
+	void Advise(const int &advice) const
+	{
+		if (address != nullptr) {
+			madvise(address, length, advice);
+		}
+	}
+};
+#endif
+
+}
+#endif
@@ -5,261 +5,2478 @@
 #include <iomanip>
 #include <vector>
 #include <stdexcept>
+#include <new>
+#include <cstdint>
+#include <type_traits>
+#include <thread>
+#include <exception>
+#include <system_error>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cmath>
+#include <limits>
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DIAMOND_MATRIX_X86 1
+#include <immintrin.h>
+#endif
 
 namespace Diamond {
 
+/**
+ * Every row of a matrix starts on a 64-byte boundary.
+ */
+const size_t MATRIX_ALIGNMENT = 64;
+
+/**
+ * A strided run of elements: a row, a column or a diagonal.
+ * Views never own their elements, they are invalidated with the matrix they look into.
+ */
+template<typename _Td>
+class VectorView {
+	_Td *base = nullptr;
+	size_t n = 0;
+	size_t step = 1;
+public:
+	VectorView() {}
+	VectorView(_Td *_base, const size_t &_n, const size_t &_step)
+		: base(_base), n(_n), step(_step) {}
+	operator VectorView<const _Td>() const
+	{
+		return VectorView<const _Td>(base, n, step);
+	}
+	inline size_t Size() const
+	{
+		return n;
+	}
+	inline size_t Step() const
+	{
+		return step;
+	}
+	inline _Td & operator[](const size_t &pos) const
+	{
+		return base[pos * step];
+	}
+};
+
+/**
+ * A rectangular window into row-major storage, rows are stride elements apart.
+ * MatrixView<const _Td> is the read-only view.
+ */
+template<typename _Td>
+class MatrixView {
+	_Td *base = nullptr;
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	size_t stride = 0;
+public:
+	MatrixView() {}
+	MatrixView(_Td *_base, const size_t &_n_rows, const size_t &_n_cols, const size_t &_stride)
+		: base(_base), n_rows(_n_rows), n_cols(_n_cols), stride(_stride) {}
+	operator MatrixView<const _Td>() const
+	{
+		return MatrixView<const _Td>(base, n_rows, n_cols, stride);
+	}
+	inline size_t RowSize() const
+	{
+		return n_rows;
+	}
+	inline size_t ColSize() const
+	{
+		return n_cols;
+	}
+	inline size_t Stride() const
+	{
+		return stride;
+	}
+	inline _Td * Data() const
+	{
+		return base;
+	}
+	inline _Td * operator[](const size_t &Kth) const
+	{
+		return base + Kth * stride;
+	}
+	VectorView<_Td> Row(const size_t &Kth) const
+	{
+		return VectorView<_Td>(base + Kth * stride, n_cols, 1);
+	}
+	VectorView<_Td> Col(const size_t &Kth) const
+	{
+		return VectorView<_Td>(base + Kth, n_rows, stride);
+	}
+	MatrixView<_Td> Block(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols) const
+	{
+		if (row + rows > n_rows || col + cols > n_cols) {
+			throw std::invalid_argument("the block is out of the matrix");
+		}
+		return MatrixView<_Td>(base + row * stride + col, rows, cols, stride);
+	}
+};
+
+/**
+ * The tunables of Parallel. They live in a class template because a header cannot define
+ * the static members of a plain class without breaking the link of a second translation unit.
+ */
+template<typename = void>
+class _ParallelSettings {
+public:
+	/**
+	 * At most threadCount threads are used, the caller counts as one of them.
+	 */
+	static unsigned threadCount;
+	/**
+	 * Each thread gets at least grain units of work, smaller loops stay serial.
+	 * A unit is roughly one multiply-add.
+	 */
+	static size_t grain;
+};
+
+template<typename _Tv> unsigned _ParallelSettings<_Tv>::threadCount = std::max(1u, std::thread::hardware_concurrency());
+template<typename _Tv> size_t _ParallelSettings<_Tv>::grain = 1 << 15;
+
+/**
+ * The thread layer behind the matrix operations. A loop over n items is cut into
+ * contiguous ranges, one per thread, and each output element is written by exactly
+ * one thread in the same order as the serial loop, so results (floating-point
+ * included) do not depend on the thread count.
+ */
+class Parallel : public _ParallelSettings<> {
+public:
+	/**
+	 * Call f(begin, end) over [0, n) where one item costs cost units.
+	 */
+	template<typename _Tf>
+	static void For(const size_t &n, const size_t &cost, _Tf f);
+};
+
+template<typename _Tf>
+void Parallel::For(const size_t &n, const size_t &cost, _Tf f)
+{
+	size_t work = n * std::max<size_t>(cost, 1) / std::max<size_t>(grain, 1);
+	unsigned threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>({threadCount, work, n})));
+	if (threads <= 1) {
+		if (n > 0) {
+			f(static_cast<size_t>(0), n);
+		}
+		return;
+	}
+	std::vector<std::exception_ptr> errors(threads);
+	auto run = [&](unsigned id) {
+		try {
+			f(n * id / threads, n * (id + 1) / threads);
+		} catch (...) {
+			errors[id] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> workers;
+	unsigned id = 1;
+	try {
+		for (; id < threads; ++id) {
+			workers.emplace_back(run, id);
+		}
+	} catch (const std::system_error &) {
+		// out of threads, do the rest here
+		for (; id < threads; ++id) {
+			run(id);
+		}
+	}
+	run(0);
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	for (std::exception_ptr &error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+/**
+ * Base of everything that evaluates to a matrix: Matrix itself and the lazy results of
+ * +, -, unary -, scalar * and /, and Transpose. _Te provides value_type, RowSize(),
+ * ColSize() and At(i, j). elementwise is true when element (i, j) reads only element (i, j)
+ * of every operand, which makes it safe to evaluate over one of those operands.
+ * An expression refers to the matrices it reads, evaluate it before they go away.
+ */
+template<typename _Te>
+class MatrixExpr {
+public:
+	inline const _Te & Self() const
+	{
+		return static_cast<const _Te &>(*this);
+	}
+};
+
+template<typename _Ta>
+class MatrixTransposeExpr;
+
+template<typename _Td>
+class Transposer;
+
+template<typename _Td>
+class Matrix : public MatrixExpr<Matrix<_Td>> {
+protected:
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	/**
+	 * One row-major buffer; each row is padded to stride elements so that every
+	 * row is 64-byte aligned whenever sizeof(_Td) divides 64.
+	 * The padding is constructed like the other elements and never read.
+	 */
+	size_t stride = 0;
+	_Td *data = nullptr;
+	void *storage = nullptr;
+
+	static size_t _Stride(const size_t &cols)
+	{
+		if (MATRIX_ALIGNMENT % sizeof(_Td) != 0) {
+			return cols;
+		}
+		size_t perLine = MATRIX_ALIGNMENT / sizeof(_Td);
+		return (cols + perLine - 1) / perLine * perLine;
+	}
+	/**
+	 * Get raw storage for rows x cols, the elements are left unconstructed.
+	 * Throws length_error when the size in bytes does not fit in a size_t.
+	 */
+	void _Allocate(const size_t &rows, const size_t &cols)
+	{
+		const size_t limit = std::numeric_limits<size_t>::max();
+		if (cols > limit - MATRIX_ALIGNMENT) {
+			throw std::length_error("the matrix is too large");
+		}
+		size_t _stride = _Stride(cols);
+		if (_stride != 0 && rows > (limit - MATRIX_ALIGNMENT) / _stride / sizeof(_Td)) {
+			throw std::length_error("the matrix is too large");
+		}
+		n_rows = rows;
+		n_cols = cols;
+		stride = _stride;
+		if (n_rows == 0 || stride == 0) {
+			return;
+		}
+		storage = ::operator new(n_rows * stride * sizeof(_Td) + MATRIX_ALIGNMENT);
+		std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage);
+		address = (address + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+		data = reinterpret_cast<_Td *>(address);
+	}
+	template<typename _Tinit>
+	void _Construct(_Tinit init)
+	{
+		size_t count = n_rows * stride, built = 0;
+		try {
+			for (; built < count; ++built) {
+				init(data + built);
+			}
+		} catch (...) {
+			_Destroy(built);
+			throw;
+		}
+	}
+	void _Destroy(const size_t &count)
+	{
+		if (!std::is_trivially_destructible<_Td>::value) {
+			for (size_t i = 0; i < count; ++i) {
+				data[i].~_Td();
+			}
+		}
+		::operator delete(storage);
+		storage = nullptr;
+		data = nullptr;
+		n_rows = n_cols = stride = 0;
+	}
+	void _Release()
+	{
+		_Destroy(n_rows * stride);
+	}
+	struct _Uninitialized {};
+	/**
+	 * Elements of a trivial _Td are left for the caller to write, only the padding is zeroed.
+	 */
+	Matrix(const size_t &_n_rows, const size_t &_n_cols, _Uninitialized)
+	{
+		_Allocate(_n_rows, _n_cols);
+		if (!std::is_trivial<_Td>::value) {
+			_Construct([](_Td *p) { new (p) _Td(); });
+			return;
+		}
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (size_t j = n_cols; j < stride; ++j) {
+				data[i * stride + j] = _Td();
+			}
+		}
+	}
+	template<typename _Te>
+	void _Assign(const _Te &expr)
+	{
+		Parallel::For(n_rows, n_cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td *z = data + i * stride;
+				for (size_t j = 0; j < n_cols; ++j) {
+					z[j] = expr.At(i, j);
+				}
+			}
+		});
+	}
+	void _Assign(const MatrixTransposeExpr<Matrix<_Td>> &expr)
+	{
+		const Matrix<_Td> &source = expr.Inner();
+		Transposer<_Td>::Copy(source.data, source.stride, data, stride, source.n_rows, source.n_cols);
+	}
+	/**
+	 * f(element, expr.At(i, j)) over the whole matrix, in place when that cannot alias.
+	 */
+	template<typename _Te, typename _Tf>
+	void _Update(const _Te &expr, _Tf f)
+	{
+		if (n_rows != expr.RowSize() || n_cols != expr.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		if (!_Te::elementwise) {
+			Matrix<_Td> value(expr);
+			_Update(value, f);
+			return;
+		}
+		Parallel::For(n_rows, n_cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td *z = data + i * stride;
+				for (size_t j = 0; j < n_cols; ++j) {
+					f(z[j], expr.At(i, j));
+				}
+			}
+		});
+	}
+public:
+	typedef _Td value_type;
+	static const bool elementwise = true;
+
+	Matrix() {};
+	Matrix(const size_t &_n_rows, const size_t &_n_cols)
+	{
+		_Allocate(_n_rows, _n_cols);
+		_Construct([](_Td *p) { new (p) _Td(); });
+	}
+	Matrix(const size_t &_n_rows, const size_t &_n_cols, const _Td &fillValue)
+	{
+		_Allocate(_n_rows, _n_cols);
+		_Construct([&fillValue](_Td *p) { new (p) _Td(fillValue); });
+	}
+	Matrix(const Matrix<_Td> &mat)
+	{
+		_Allocate(mat.n_rows, mat.n_cols);
+		const _Td *source = mat.data;
+		_Construct([this, source](_Td *p) { new (p) _Td(source[p - data]); });
+	}
+	Matrix(Matrix<_Td> &&mat) noexcept
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), stride(mat.stride), data(mat.data), storage(mat.storage)
+	{
+		mat.n_rows = mat.n_cols = mat.stride = 0;
+		mat.data = nullptr;
+		mat.storage = nullptr;
+	}
+	/**
+	 * Evaluate an expression in one pass, the only allocation is the result.
+	 */
+	template<typename _Te>
+	Matrix(const MatrixExpr<_Te> &expr)
+		: Matrix(expr.Self().RowSize(), expr.Self().ColSize(), _Uninitialized())
+	{
+		_Assign(expr.Self());
+	}
+	/**
+	 * Copy the elements a view looks at into a new matrix.
+	 */
+	template<typename _Tv>
+	explicit Matrix(const MatrixView<_Tv> &view)
+		: Matrix(view.RowSize(), view.ColSize())
+	{
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (size_t j = 0; j < n_cols; ++j) {
+				data[i * stride + j] = view[i][j];
+			}
+		}
+	}
+	Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
+	{
+		if (this == &rhs) {
+			return *this;
+		}
+		if (n_rows == rhs.n_rows && n_cols == rhs.n_cols) {
+			for (size_t i = 0; i < n_rows * stride; ++i) {
+				data[i] = rhs.data[i];
+			}
+			return *this;
+		}
+		Matrix<_Td> copy(rhs);
+		return *this = std::move(copy);
+	}
+	Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+	{
+		if (this == &rhs) {
+			return *this;
+		}
+		_Release();
+		n_rows = rhs.n_rows;
+		n_cols = rhs.n_cols;
+		stride = rhs.stride;
+		data = rhs.data;
+		storage = rhs.storage;
+		rhs.n_rows = rhs.n_cols = rhs.stride = 0;
+		rhs.data = nullptr;
+		rhs.storage = nullptr;
+		return *this;
+	}
+	/**
+	 * An elementwise expression of the same size is evaluated straight into this buffer,
+	 * anything else goes through a temporary.
+	 */
+	template<typename _Te>
+	Matrix<_Td> & operator=(const MatrixExpr<_Te> &expr)
+	{
+		const _Te &source = expr.Self();
+		if (_Te::elementwise && n_rows == source.RowSize() && n_cols == source.ColSize()) {
+			_Assign(source);
+			return *this;
+		}
+		Matrix<_Td> result(source);
+		return *this = std::move(result);
+	}
+	/**
+	 * A transpose is written straight into a distinct matrix of the right shape,
+	 * and A = Transpose(A) transposes in place.
+	 */
+	Matrix<_Td> & operator=(const MatrixTransposeExpr<Matrix<_Td>> &expr)
+	{
+		if (&expr.Inner() == this) {
+			TransposeInPlace();
+			return *this;
+		}
+		if (n_rows == expr.RowSize() && n_cols == expr.ColSize()) {
+			_Assign(expr);
+			return *this;
+		}
+		Matrix<_Td> result(expr);
+		return *this = std::move(result);
+	}
+	template<typename _Te>
+	Matrix<_Td> & operator+=(const MatrixExpr<_Te> &expr)
+	{
+		_Update(expr.Self(), [](_Td &z, const _Td &x) { z += x; });
+		return *this;
+	}
+	template<typename _Te>
+	Matrix<_Td> & operator-=(const MatrixExpr<_Te> &expr)
+	{
+		_Update(expr.Self(), [](_Td &z, const _Td &x) { z -= x; });
+		return *this;
+	}
+	Matrix<_Td> & operator*=(const _Td &value)
+	{
+		_Update(*this, [&value](_Td &z, const _Td &) { z *= value; });
+		return *this;
+	}
+	Matrix<_Td> & operator/=(const double &value)
+	{
+		_Update(*this, [&value](_Td &z, const _Td &) { z /= value; });
+		return *this;
+	}
+	/**
+	 * A square matrix is transposed without allocating, other shapes need a new buffer.
+	 */
+	void TransposeInPlace()
+	{
+		if (n_rows != n_cols) {
+			Matrix<_Td> result(MatrixTransposeExpr<Matrix<_Td>>(*this));
+			*this = std::move(result);
+			return;
+		}
+		Transposer<_Td>::Square(data, stride, n_rows);
+	}
+	void Fill(const _Td &value)
+	{
+		_Update(*this, [&value](_Td &z, const _Td &) { z = value; });
+	}
+	inline const size_t & RowSize() const
+	{
+		return n_rows;
+	}
+	inline const size_t & ColSize() const
+	{
+		return n_cols;
+	}
+	/**
+	 * Distance in elements between the starts of two adjacent rows.
+	 */
+	inline const size_t & Stride() const
+	{
+		return stride;
+	}
+	inline const _Td & At(const size_t &i, const size_t &j) const
+	{
+		return data[i * stride + j];
+	}
+	inline _Td * Data()
+	{
+		return data;
+	}
+	inline const _Td * Data() const
+	{
+		return data;
+	}
+	inline _Td * operator[](const size_t &Kth)
+	{
+		return data + Kth * stride;
+	}
+	inline const _Td * operator[](const size_t &Kth) const
+	{
+		return data + Kth * stride;
+	}
+	MatrixView<_Td> View()
+	{
+		return MatrixView<_Td>(data, n_rows, n_cols, stride);
+	}
+	MatrixView<const _Td> View() const
+	{
+		return MatrixView<const _Td>(data, n_rows, n_cols, stride);
+	}
+	VectorView<_Td> Row(const size_t &Kth)
+	{
+		return View().Row(Kth);
+	}
+	VectorView<const _Td> Row(const size_t &Kth) const
+	{
+		return View().Row(Kth);
+	}
+	VectorView<_Td> Col(const size_t &Kth)
+	{
+		return View().Col(Kth);
+	}
+	VectorView<const _Td> Col(const size_t &Kth) const
+	{
+		return View().Col(Kth);
+	}
+	MatrixView<_Td> Block(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols)
+	{
+		return View().Block(row, col, rows, cols);
+	}
+	MatrixView<const _Td> Block(const size_t &row, const size_t &col, const size_t &rows, const size_t &cols) const
+	{
+		return View().Block(row, col, rows, cols);
+	}
+	~Matrix()
+	{
+		_Release();
+	}
+};
+
+/**
+ * Leaves are held by reference, inner nodes by value.
+ */
+template<typename _Te>
+struct ExprOperand {
+	typedef const _Te type;
+};
+
+template<typename _Td>
+struct ExprOperand<Matrix<_Td>> {
+	typedef const Matrix<_Td> &type;
+};
+
+struct ExprAdd {
+	template<typename _Td>
+	static inline _Td Apply(const _Td &x, const _Td &y)
+	{
+		return x + y;
+	}
+};
+
+struct ExprSub {
+	template<typename _Td>
+	static inline _Td Apply(const _Td &x, const _Td &y)
+	{
+		return x - y;
+	}
+};
+
+struct ExprMul {
+	template<typename _Td, typename _Ts>
+	static inline _Td Apply(const _Td &x, const _Ts &s)
+	{
+		return x * s;
+	}
+};
+
+struct ExprDiv {
+	template<typename _Td, typename _Ts>
+	static inline _Td Apply(const _Td &x, const _Ts &s)
+	{
+		return x / s;
+	}
+};
+
+template<typename _Ta, typename _Tb, typename _Top>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<_Ta, _Tb, _Top>> {
+	typename ExprOperand<_Ta>::type a;
+	typename ExprOperand<_Tb>::type b;
+public:
+	typedef typename _Ta::value_type value_type;
+	static const bool elementwise = _Ta::elementwise && _Tb::elementwise;
+
+	MatrixBinaryExpr(const _Ta &_a, const _Tb &_b) : a(_a), b(_b) {}
+	inline size_t RowSize() const
+	{
+		return a.RowSize();
+	}
+	inline size_t ColSize() const
+	{
+		return a.ColSize();
+	}
+	inline value_type At(const size_t &i, const size_t &j) const
+	{
+		return _Top::template Apply<value_type>(a.At(i, j), b.At(i, j));
+	}
+};
+
+template<typename _Ta, typename _Ts, typename _Top>
+class MatrixScalarExpr : public MatrixExpr<MatrixScalarExpr<_Ta, _Ts, _Top>> {
+	typename ExprOperand<_Ta>::type a;
+	_Ts s;
+public:
+	typedef typename _Ta::value_type value_type;
+	static const bool elementwise = _Ta::elementwise;
+
+	MatrixScalarExpr(const _Ta &_a, const _Ts &_s) : a(_a), s(_s) {}
+	inline size_t RowSize() const
+	{
+		return a.RowSize();
+	}
+	inline size_t ColSize() const
+	{
+		return a.ColSize();
+	}
+	inline value_type At(const size_t &i, const size_t &j) const
+	{
+		return _Top::template Apply<value_type, _Ts>(a.At(i, j), s);
+	}
+};
+
+template<typename _Ta>
+class MatrixNegateExpr : public MatrixExpr<MatrixNegateExpr<_Ta>> {
+	typename ExprOperand<_Ta>::type a;
+public:
+	typedef typename _Ta::value_type value_type;
+	static const bool elementwise = _Ta::elementwise;
+
+	explicit MatrixNegateExpr(const _Ta &_a) : a(_a) {}
+	inline size_t RowSize() const
+	{
+		return a.RowSize();
+	}
+	inline size_t ColSize() const
+	{
+		return a.ColSize();
+	}
+	inline value_type At(const size_t &i, const size_t &j) const
+	{
+		return -a.At(i, j);
+	}
+};
+
+/**
+ * Transpose(A) only swaps indices, a product with it packs A in the transposed order.
+ */
+template<typename _Ta>
+class MatrixTransposeExpr : public MatrixExpr<MatrixTransposeExpr<_Ta>> {
+	typename ExprOperand<_Ta>::type a;
+public:
+	typedef typename _Ta::value_type value_type;
+	static const bool elementwise = false;
+
+	explicit MatrixTransposeExpr(const _Ta &_a) : a(_a) {}
+	inline const _Ta & Inner() const
+	{
+		return a;
+	}
+	inline size_t RowSize() const
+	{
+		return a.ColSize();
+	}
+	inline size_t ColSize() const
+	{
+		return a.RowSize();
+	}
+	inline value_type At(const size_t &i, const size_t &j) const
+	{
+		return a.At(j, i);
+	}
+};
+
+/**
+ * Sum of two matrics.
+ */
+template<typename _Ta, typename _Tb>
+MatrixBinaryExpr<_Ta, _Tb, ExprAdd> operator+(const MatrixExpr<_Ta> &a, const MatrixExpr<_Tb> &b)
+{
+	if (a.Self().RowSize() != b.Self().RowSize() || a.Self().ColSize() != b.Self().ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	return MatrixBinaryExpr<_Ta, _Tb, ExprAdd>(a.Self(), b.Self());
+}
+
+template<typename _Ta, typename _Tb>
+MatrixBinaryExpr<_Ta, _Tb, ExprSub> operator-(const MatrixExpr<_Ta> &a, const MatrixExpr<_Tb> &b)
+{
+	if (a.Self().RowSize() != b.Self().RowSize() || a.Self().ColSize() != b.Self().ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	return MatrixBinaryExpr<_Ta, _Tb, ExprSub>(a.Self(), b.Self());
+}
+
+template<typename _Ta, typename _Tb>
+bool operator==(const MatrixExpr<_Ta> &a, const MatrixExpr<_Tb> &b)
+{
+	const _Ta &x = a.Self();
+	const _Tb &y = b.Self();
+	if (x.RowSize() != y.RowSize() || x.ColSize() != y.ColSize()) {
+		return false;
+	}
+	for (size_t i = 0; i < x.RowSize(); ++i) {
+		for (size_t j = 0; j < x.ColSize(); ++j) {
+			if (x.At(i, j) != y.At(i, j))
+				return false;
+		}
+	}
+	return true;
+}
+
+template<typename _Te>
+MatrixNegateExpr<_Te> operator-(const MatrixExpr<_Te> &mat)
+{
+	return MatrixNegateExpr<_Te>(mat.Self());
+}
+
+template<typename _Td>
+Matrix<_Td> operator-(Matrix<_Td> &&mat)
+{
+	Parallel::For(mat.RowSize(), mat.ColSize(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			_Td *x = mat[i];
+			for (size_t j = 0; j < mat.ColSize(); ++j) {
+				x[j] = -x[j];
+			}
+		}
+	});
+	return std::move(mat);
+}
+
+/**
+ * Register tile of the GEMM micro-kernel; NR fills one 256-bit register by default.
+ */
+template<typename _Td>
+struct GemmShape {
+	static const size_t MR = 4;
+	static const size_t NR = 32 / sizeof(_Td) < 4 ? 4 : 32 / sizeof(_Td);
+};
+
+template<>
+struct GemmShape<double> {
+	static const size_t MR = 6;
+	static const size_t NR = 8;
+};
+
+template<>
+struct GemmShape<float> {
+	static const size_t MR = 6;
+	static const size_t NR = 16;
+};
+
+/**
+ * Blocked matrix multiplication after GotoBLAS. B is packed kc x nc at a time into
+ * panels NR columns wide, A is packed mc x kc at a time into panels MR rows tall,
+ * and a register-tiled micro-kernel multiplies one pair of panels into an MR x NR tile of C.
+ * Every operand is addressed through a row stride and a column stride, so a transposed
+ * operand costs nothing but a different packing order.
+ * Types that are not arithmetic skip the packing and run a k-blocked i-k-j loop.
+ */
+template<typename _Td>
+class Gemm {
+	static const size_t MR = GemmShape<_Td>::MR;
+	static const size_t NR = GemmShape<_Td>::NR;
+
+	static void _PackA(const _Td *a, const size_t &rsa, const size_t &csa, const size_t &m, const size_t &k, _Td *pack);
+	static void _PackB(const _Td *b, const size_t &rsb, const size_t &csb, const size_t &k, const size_t &n, _Td *pack);
+	__attribute__((always_inline))
+	static inline void _KernelBody(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc);
+	static void _KernelGeneric(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc);
+#ifdef DIAMOND_MATRIX_X86
+	__attribute__((target("avx2")))
+	static void _KernelAVX2(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc);
+#endif
+	static void _Kernel(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc);
+	static void _Packed(const size_t &m, const size_t &n, const size_t &k,
+		const _Td *a, const size_t &rsa, const size_t &csa,
+		const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc);
+	static void _Loop(const size_t &m, const size_t &n, const size_t &k,
+		const _Td *a, const size_t &rsa, const size_t &csa,
+		const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc);
+public:
+	/**
+	 * Block sizes: a kc x NR panel of B should stay in L1, an mc x kc block of A in L2
+	 * and a kc x nc block of B in L3.
+	 */
+	static size_t mc, kc, nc;
+	/**
+	 * Products with a dimension below cutoff are not worth packing.
+	 */
+	static size_t cutoff;
+	/**
+	 * C += A * B, A is m x k, B is k x n and C is m x n with rows ldc elements apart.
+	 * A(i, p) is a[i * rsa + p * csa] and B(p, j) is b[p * rsb + j * csb].
+	 */
+	static void Multiply(const size_t &m, const size_t &n, const size_t &k,
+		const _Td *a, const size_t &rsa, const size_t &csa,
+		const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc);
+};
+
+template<typename _Td> const size_t Gemm<_Td>::MR;
+template<typename _Td> const size_t Gemm<_Td>::NR;
+template<typename _Td> size_t Gemm<_Td>::mc = 96;
+template<typename _Td> size_t Gemm<_Td>::kc = 256;
+template<typename _Td> size_t Gemm<_Td>::nc = 4096;
+template<typename _Td> size_t Gemm<_Td>::cutoff = 16;
+
+#ifdef DIAMOND_MATRIX_X86
+inline bool _HasAVX2()
+{
+	static const bool has = __builtin_cpu_supports("avx2");
+	return has;
+}
+
+inline bool _HasFMA()
+{
+	static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return has;
+}
+#endif
+
+/**
+ * Rows past m and columns past k are zero, so the kernel never needs a bounds check.
+ */
+template<typename _Td>
+void Gemm<_Td>::_PackA(const _Td *a, const size_t &rsa, const size_t &csa, const size_t &m, const size_t &k, _Td *pack)
+{
+	for (size_t i = 0; i < m; i += MR) {
+		size_t rows = m - i < MR ? m - i : MR;
+		for (size_t p = 0; p < k; ++p) {
+			const _Td *column = a + i * rsa + p * csa;
+			for (size_t r = 0; r < rows; ++r) {
+				pack[r] = column[r * rsa];
+			}
+			for (size_t r = rows; r < MR; ++r) {
+				pack[r] = static_cast<_Td>(0);
+			}
+			pack += MR;
+		}
+	}
+}
+
+template<typename _Td>
+void Gemm<_Td>::_PackB(const _Td *b, const size_t &rsb, const size_t &csb, const size_t &k, const size_t &n, _Td *pack)
+{
+	for (size_t j = 0; j < n; j += NR) {
+		size_t cols = n - j < NR ? n - j : NR;
+		for (size_t p = 0; p < k; ++p) {
+			const _Td *row = b + p * rsb + j * csb;
+			for (size_t r = 0; r < cols; ++r) {
+				pack[r] = row[r * csb];
+			}
+			for (size_t r = cols; r < NR; ++r) {
+				pack[r] = static_cast<_Td>(0);
+			}
+			pack += NR;
+		}
+	}
+}
+
+/**
+ * Constant trip counts let the compiler vectorize the j loop for whatever instruction set
+ * the caller is compiled for; unrolling the i loop keeps the tile in registers.
+ */
+template<typename _Td>
+inline void Gemm<_Td>::_KernelBody(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc)
+{
+	_Td acc[MR][NR] = {};
+	for (size_t p = 0; p < k; ++p, a += MR, b += NR) {
+#pragma GCC unroll 8
+		for (size_t i = 0; i < MR; ++i) {
+			for (size_t j = 0; j < NR; ++j) {
+				acc[i][j] += a[i] * b[j];
+			}
+		}
+	}
+	for (size_t i = 0; i < MR; ++i) {
+		for (size_t j = 0; j < NR; ++j) {
+			c[i * ldc + j] += acc[i][j];
+		}
+	}
+}
+
+template<typename _Td>
+void Gemm<_Td>::_KernelGeneric(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc)
+{
+	_KernelBody(k, a, b, c, ldc);
+}
+
+#ifdef DIAMOND_MATRIX_X86
+template<typename _Td>
+void Gemm<_Td>::_KernelAVX2(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc)
+{
+	_KernelBody(k, a, b, c, ldc);
+}
+#endif
+
+template<typename _Td>
+void Gemm<_Td>::_Kernel(const size_t &k, const _Td *a, const _Td *b, _Td *c, const size_t &ldc)
+{
+#ifdef DIAMOND_MATRIX_X86
+	if (_HasAVX2()) {
+		_KernelAVX2(k, a, b, c, ldc);
+		return;
+	}
+#endif
+	_KernelGeneric(k, a, b, c, ldc);
+}
+
+#ifdef DIAMOND_MATRIX_X86
+/**
+ * 6 x 8 doubles: twelve accumulators, two rows of B and one broadcast of A
+ * fill fifteen of the sixteen ymm registers. The tile is spelled out register by register,
+ * an array of accumulators would be spilled to the stack.
+ */
+__attribute__((target("avx2,fma")))
+inline void _GemmKernelDoubleFMA(const size_t &k, const double *a, const double *b, double *c, const size_t &ldc)
+{
+	__m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m256d c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < k; ++p, a += 6, b += 8) {
+		__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4), x;
+		x = _mm256_broadcast_sd(a + 0);
+		c00 = _mm256_fmadd_pd(x, b0, c00);
+		c01 = _mm256_fmadd_pd(x, b1, c01);
+		x = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(x, b0, c10);
+		c11 = _mm256_fmadd_pd(x, b1, c11);
+		x = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(x, b0, c20);
+		c21 = _mm256_fmadd_pd(x, b1, c21);
+		x = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(x, b0, c30);
+		c31 = _mm256_fmadd_pd(x, b1, c31);
+		x = _mm256_broadcast_sd(a + 4);
+		c40 = _mm256_fmadd_pd(x, b0, c40);
+		c41 = _mm256_fmadd_pd(x, b1, c41);
+		x = _mm256_broadcast_sd(a + 5);
+		c50 = _mm256_fmadd_pd(x, b0, c50);
+		c51 = _mm256_fmadd_pd(x, b1, c51);
+	}
+	__m256d tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t i = 0; i < 6; ++i) {
+		double *row = c + i * ldc;
+		_mm256_storeu_pd(row, _mm256_add_pd(_mm256_loadu_pd(row), tile[i][0]));
+		_mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), tile[i][1]));
+	}
+}
+
+/**
+ * 6 x 16 floats, the same register budget as the double kernel.
+ */
+__attribute__((target("avx2,fma")))
+inline void _GemmKernelFloatFMA(const size_t &k, const float *a, const float *b, float *c, const size_t &ldc)
+{
+	__m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+	__m256 c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+	for (size_t p = 0; p < k; ++p, a += 6, b += 16) {
+		__m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8), x;
+		x = _mm256_broadcast_ss(a + 0);
+		c00 = _mm256_fmadd_ps(x, b0, c00);
+		c01 = _mm256_fmadd_ps(x, b1, c01);
+		x = _mm256_broadcast_ss(a + 1);
+		c10 = _mm256_fmadd_ps(x, b0, c10);
+		c11 = _mm256_fmadd_ps(x, b1, c11);
+		x = _mm256_broadcast_ss(a + 2);
+		c20 = _mm256_fmadd_ps(x, b0, c20);
+		c21 = _mm256_fmadd_ps(x, b1, c21);
+		x = _mm256_broadcast_ss(a + 3);
+		c30 = _mm256_fmadd_ps(x, b0, c30);
+		c31 = _mm256_fmadd_ps(x, b1, c31);
+		x = _mm256_broadcast_ss(a + 4);
+		c40 = _mm256_fmadd_ps(x, b0, c40);
+		c41 = _mm256_fmadd_ps(x, b1, c41);
+		x = _mm256_broadcast_ss(a + 5);
+		c50 = _mm256_fmadd_ps(x, b0, c50);
+		c51 = _mm256_fmadd_ps(x, b1, c51);
+	}
+	__m256 tile[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+	for (size_t i = 0; i < 6; ++i) {
+		float *row = c + i * ldc;
+		_mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), tile[i][0]));
+		_mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), tile[i][1]));
+	}
+}
+#endif
+
+#ifdef DIAMOND_MATRIX_X86
+template<>
+inline void Gemm<double>::_Kernel(const size_t &k, const double *a, const double *b, double *c, const size_t &ldc)
+{
+	if (_HasFMA()) {
+		_GemmKernelDoubleFMA(k, a, b, c, ldc);
+		return;
+	}
+	_KernelGeneric(k, a, b, c, ldc);
+}
+
+template<>
+inline void Gemm<float>::_Kernel(const size_t &k, const float *a, const float *b, float *c, const size_t &ldc)
+{
+	if (_HasFMA()) {
+		_GemmKernelFloatFMA(k, a, b, c, ldc);
+		return;
+	}
+	_KernelGeneric(k, a, b, c, ldc);
+}
+#endif
+
+/**
+ * Tiles cut by the edge of C are computed into a scratch tile and only the valid part is added.
+ * The threads share each packed block of B and split C by MR-row panels, every thread
+ * packing its own rows of A; a tile of C is still summed over k in one fixed order.
+ */
+template<typename _Td>
+void Gemm<_Td>::_Packed(const size_t &m, const size_t &n, const size_t &k,
+	const _Td *a, const size_t &rsa, const size_t &csa,
+	const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc)
+{
+	size_t mb = (mc + MR - 1) / MR * MR, nb = (nc + NR - 1) / NR * NR;
+	std::vector<_Td> packB(nb * kc);
+	for (size_t jc = 0; jc < n; jc += nb) {
+		size_t ncur = n - jc < nb ? n - jc : nb;
+		for (size_t pc = 0; pc < k; pc += kc) {
+			size_t kcur = k - pc < kc ? k - pc : kc;
+			Parallel::For((ncur + NR - 1) / NR, kcur * NR, [&](size_t begin, size_t end) {
+				size_t first = begin * NR, last = std::min(end * NR, ncur);
+				_PackB(b + pc * rsb + (jc + first) * csb, rsb, csb, kcur, last - first, packB.data() + first * kcur);
+			});
+			Parallel::For((m + MR - 1) / MR, MR * kcur * ncur, [&](size_t begin, size_t end) {
+				size_t first = begin * MR, last = std::min(end * MR, m);
+				std::vector<_Td> packA(mb * kcur);
+				_Td edge[MR * NR];
+				for (size_t ic = first; ic < last; ic += mb) {
+					size_t mcur = last - ic < mb ? last - ic : mb;
+					_PackA(a + ic * rsa + pc * csa, rsa, csa, mcur, kcur, packA.data());
+					for (size_t jr = 0; jr < ncur; jr += NR) {
+						size_t cols = ncur - jr < NR ? ncur - jr : NR;
+						const _Td *pb = packB.data() + jr * kcur;
+						for (size_t ir = 0; ir < mcur; ir += MR) {
+							size_t rows = mcur - ir < MR ? mcur - ir : MR;
+							const _Td *pa = packA.data() + ir * kcur;
+							_Td *tile = c + (ic + ir) * ldc + jc + jr;
+							if (rows == MR && cols == NR) {
+								_Kernel(kcur, pa, pb, tile, ldc);
+								continue;
+							}
+							for (size_t t = 0; t < MR * NR; ++t) {
+								edge[t] = static_cast<_Td>(0);
+							}
+							_Kernel(kcur, pa, pb, edge, NR);
+							for (size_t i = 0; i < rows; ++i) {
+								for (size_t j = 0; j < cols; ++j) {
+									tile[i * ldc + j] += edge[i * NR + j];
+								}
+							}
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+template<typename _Td>
+void Gemm<_Td>::_Loop(const size_t &m, const size_t &n, const size_t &k,
+	const _Td *a, const size_t &rsa, const size_t &csa,
+	const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc)
+{
+	size_t block = kc == 0 ? k : kc;
+	Parallel::For(m, n * k, [&](size_t begin, size_t end) {
+		for (size_t pc = 0; pc < k; pc += block) {
+			size_t pend = k - pc < block ? k : pc + block;
+			for (size_t i = begin; i < end; ++i) {
+				_Td *z = c + i * ldc;
+				for (size_t p = pc; p < pend; ++p) {
+					const _Td &x = a[i * rsa + p * csa];
+					const _Td *y = b + p * rsb;
+					for (size_t j = 0; j < n; ++j) {
+						z[j] += x * y[j * csb];
+					}
+				}
+			}
+		}
+	});
+}
+
+template<typename _Td>
+void Gemm<_Td>::Multiply(const size_t &m, const size_t &n, const size_t &k,
+	const _Td *a, const size_t &rsa, const size_t &csa,
+	const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc)
+{
+	if (m == 0 || n == 0 || k == 0) {
+		return;
+	}
+	if (!std::is_arithmetic<_Td>::value || m < cutoff || n < cutoff || k < cutoff || kc == 0) {
+		_Loop(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc);
+		return;
+	}
+	_Packed(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc);
+}
+
+/**
+ * What Gemm reads for one operand of a product: a Matrix or the transpose of one is used
+ * in place through its strides, any other expression is evaluated first.
+ */
+template<typename _Te>
+class GemmOperand {
+	Matrix<typename _Te::value_type> copy;
+public:
+	const typename _Te::value_type *data;
+	size_t rs, cs;
+
+	explicit GemmOperand(const _Te &expr) : copy(expr), data(copy.Data()), rs(copy.Stride()), cs(1) {}
+};
+
+template<typename _Td>
+class GemmOperand<Matrix<_Td>> {
+public:
+	const _Td *data;
+	size_t rs, cs;
+
+	explicit GemmOperand(const Matrix<_Td> &mat) : data(mat.Data()), rs(mat.Stride()), cs(1) {}
+};
+
+template<typename _Td>
+class GemmOperand<MatrixTransposeExpr<Matrix<_Td>>> {
+public:
+	const _Td *data;
+	size_t rs, cs;
+
+	explicit GemmOperand(const MatrixTransposeExpr<Matrix<_Td>> &expr)
+		: data(expr.Inner().Data()), rs(1), cs(expr.Inner().Stride()) {}
+};
+
+/**
+ * dst = a * b, reusing the buffer of dst when it already has the right size.
+ * dst may be one of the operands, the product then goes through a temporary.
+ */
+template<typename _Td, typename _Ta, typename _Tb>
+Matrix<_Td> & MultiplyInto(Matrix<_Td> &dst, const MatrixExpr<_Ta> &a, const MatrixExpr<_Tb> &b)
+{
+	const _Ta &x = a.Self();
+	const _Tb &y = b.Self();
+	if (x.ColSize() != y.RowSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	GemmOperand<_Ta> left(x);
+	GemmOperand<_Tb> right(y);
+	const _Td *begin = dst.Data(), *end = begin + dst.RowSize() * dst.Stride();
+	std::less<const _Td *> less;
+	bool overlap = (!less(left.data, begin) && less(left.data, end))
+		|| (!less(right.data, begin) && less(right.data, end));
+	if (overlap || dst.RowSize() != x.RowSize() || dst.ColSize() != y.ColSize()) {
+		Matrix<_Td> result(x.RowSize(), y.ColSize(), 0);
+		Gemm<_Td>::Multiply(x.RowSize(), y.ColSize(), x.ColSize(),
+			left.data, left.rs, left.cs, right.data, right.rs, right.cs, result.Data(), result.Stride());
+		return dst = std::move(result);
+	}
+	dst.Fill(static_cast<_Td>(0));
+	Gemm<_Td>::Multiply(x.RowSize(), y.ColSize(), x.ColSize(),
+		left.data, left.rs, left.cs, right.data, right.rs, right.cs, dst.Data(), dst.Stride());
+	return dst;
+}
+
+/**
+ * Multiplication of two matrics.
+ */
+template<typename _Ta, typename _Tb>
+Matrix<typename _Ta::value_type> operator*(const MatrixExpr<_Ta> &a, const MatrixExpr<_Tb> &b)
+{
+	Matrix<typename _Ta::value_type> c;
+	MultiplyInto(c, a, b);
+	return c;
+}
+
+/**
+ * Operations between a number and a matrix;
+ */
+template<typename _Te>
+MatrixScalarExpr<_Te, typename _Te::value_type, ExprMul> operator*(const MatrixExpr<_Te> &a, const typename _Te::value_type &b)
+{
+	return MatrixScalarExpr<_Te, typename _Te::value_type, ExprMul>(a.Self(), b);
+}
+
+template<typename _Te>
+MatrixScalarExpr<_Te, typename _Te::value_type, ExprMul> operator*(const typename _Te::value_type &b, const MatrixExpr<_Te> &a)
+{
+	return a * b;
+}
+
+template<typename _Te>
+MatrixScalarExpr<_Te, double, ExprDiv> operator/(const MatrixExpr<_Te> &a, const double &b)
+{
+	return MatrixScalarExpr<_Te, double, ExprDiv>(a.Self(), b);
+}
+
+#ifdef DIAMOND_MATRIX_X86
+/**
+ * 4 x 4 blocks of 8-byte elements and 8 x 8 blocks of 4-byte elements are transposed in
+ * registers with unpacks and lane permutes; the bits are moved, never interpreted.
+ * A copy moves two such blocks stacked vertically, so every row it writes is one full
+ * 64-byte line, which lets large copies use streaming stores and skip reading dst.
+ */
+__attribute__((target("avx")))
+inline void _Transpose4x4(__m256d *r)
+{
+	__m256d t0 = _mm256_unpacklo_pd(r[0], r[1]), t1 = _mm256_unpackhi_pd(r[0], r[1]);
+	__m256d t2 = _mm256_unpacklo_pd(r[2], r[3]), t3 = _mm256_unpackhi_pd(r[2], r[3]);
+	r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+	r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+	r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+	r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+__attribute__((target("avx")))
+inline void _Transpose8x8(__m256 *r)
+{
+	__m256 t[8], u[8];
+	for (size_t i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+	}
+	for (size_t i = 0; i < 8; i += 4) {
+		u[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+		u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+		u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+		u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+	}
+	for (size_t i = 0; i < 4; ++i) {
+		r[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+		r[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+	}
+}
+
+/**
+ * 8 source rows x 4 columns of 8-byte elements.
+ */
+__attribute__((target("avx")))
+inline void _CopyBlock8x4(const void *src, const size_t &ls, void *dst, const size_t &ld, const bool &stream)
+{
+	const double *s = static_cast<const double *>(src);
+	double *d = static_cast<double *>(dst);
+	__m256d top[4], bottom[4];
+	for (size_t i = 0; i < 4; ++i) {
+		top[i] = _mm256_loadu_pd(s + i * ls);
+		bottom[i] = _mm256_loadu_pd(s + (i + 4) * ls);
+	}
+	_Transpose4x4(top);
+	_Transpose4x4(bottom);
+	for (size_t i = 0; i < 4; ++i) {
+		if (stream) {
+			_mm256_stream_pd(d + i * ld, top[i]);
+			_mm256_stream_pd(d + i * ld + 4, bottom[i]);
+		} else {
+			_mm256_storeu_pd(d + i * ld, top[i]);
+			_mm256_storeu_pd(d + i * ld + 4, bottom[i]);
+		}
+	}
+}
+
+/**
+ * 16 source rows x 8 columns of 4-byte elements.
+ */
+__attribute__((target("avx")))
+inline void _CopyBlock16x8(const void *src, const size_t &ls, void *dst, const size_t &ld, const bool &stream)
+{
+	const float *s = static_cast<const float *>(src);
+	float *d = static_cast<float *>(dst);
+	__m256 top[8], bottom[8];
+	for (size_t i = 0; i < 8; ++i) {
+		top[i] = _mm256_loadu_ps(s + i * ls);
+		bottom[i] = _mm256_loadu_ps(s + (i + 8) * ls);
+	}
+	_Transpose8x8(top);
+	_Transpose8x8(bottom);
+	for (size_t i = 0; i < 8; ++i) {
+		if (stream) {
+			_mm256_stream_ps(d + i * ld, top[i]);
+			_mm256_stream_ps(d + i * ld + 8, bottom[i]);
+		} else {
+			_mm256_storeu_ps(d + i * ld, top[i]);
+			_mm256_storeu_ps(d + i * ld + 8, bottom[i]);
+		}
+	}
+}
+
+__attribute__((target("avx")))
+inline void _SwapBlock4x4(void *x, void *y, const size_t &ld)
+{
+	double *a = static_cast<double *>(x), *b = static_cast<double *>(y);
+	__m256d p[4], q[4];
+	for (size_t i = 0; i < 4; ++i) {
+		p[i] = _mm256_loadu_pd(a + i * ld);
+		q[i] = _mm256_loadu_pd(b + i * ld);
+	}
+	_Transpose4x4(p);
+	_Transpose4x4(q);
+	for (size_t i = 0; i < 4; ++i) {
+		_mm256_storeu_pd(b + i * ld, p[i]);
+		_mm256_storeu_pd(a + i * ld, q[i]);
+	}
+}
+
+__attribute__((target("avx")))
+inline void _SwapBlock8x8(void *x, void *y, const size_t &ld)
+{
+	float *a = static_cast<float *>(x), *b = static_cast<float *>(y);
+	__m256 p[8], q[8];
+	for (size_t i = 0; i < 8; ++i) {
+		p[i] = _mm256_loadu_ps(a + i * ld);
+		q[i] = _mm256_loadu_ps(b + i * ld);
+	}
+	_Transpose8x8(p);
+	_Transpose8x8(q);
+	for (size_t i = 0; i < 8; ++i) {
+		_mm256_storeu_ps(b + i * ld, p[i]);
+		_mm256_storeu_ps(a + i * ld, q[i]);
+	}
+}
+#endif
+
+/**
+ * Blocked transposition. The matrix is walked in TILE x TILE tiles so the rows being read
+ * and the rows being written both stay in cache; inside a tile, trivially copyable elements
+ * of 8 or 4 bytes move in register-transposed blocks, anything else element by element.
+ */
+template<typename _Td>
+class Transposer {
+	static const size_t TILE = 32;
+
+	static bool _Vector()
+	{
+#ifdef DIAMOND_MATRIX_X86
+		return std::is_trivially_copyable<_Td>::value && (sizeof(_Td) == 8 || sizeof(_Td) == 4) && _HasAVX2();
+#else
+		return false;
+#endif
+	}
+	static void _CopyBlock(const _Td *src, const size_t &ls, _Td *dst, const size_t &ld, const bool &stream)
+	{
+#ifdef DIAMOND_MATRIX_X86
+		if (sizeof(_Td) == 8) {
+			_CopyBlock8x4(src, ls, dst, ld, stream);
+		} else {
+			_CopyBlock16x8(src, ls, dst, ld, stream);
+		}
+#endif
+	}
+	static void _SwapBlock(_Td *x, _Td *y, const size_t &ld)
+	{
+#ifdef DIAMOND_MATRIX_X86
+		if (sizeof(_Td) == 8) {
+			_SwapBlock4x4(x, y, ld);
+		} else {
+			_SwapBlock8x8(x, y, ld);
+		}
+#endif
+	}
+public:
+	/**
+	 * Results larger than this many bytes are written with streaming stores.
+	 */
+	static size_t streamBytes;
+	/**
+	 * dst = transpose of src, src is rows x cols; ls and ld are the row strides.
+	 */
+	static void Copy(const _Td *src, const size_t &ls, _Td *dst, const size_t &ld, const size_t &rows, const size_t &cols)
+	{
+		const bool vector = _Vector();
+		const size_t bi = vector ? 32 / sizeof(_Td) * 2 : 1, bj = vector ? 32 / sizeof(_Td) : 1;
+		const bool stream = vector && cols * ld * sizeof(_Td) >= streamBytes
+			&& reinterpret_cast<std::uintptr_t>(dst) % 32 == 0 && ld * sizeof(_Td) % 32 == 0;
+		Parallel::For((rows + TILE - 1) / TILE, TILE * cols, [&](size_t begin, size_t end) {
+			for (size_t ti = begin * TILE; ti < std::min(end * TILE, rows); ti += TILE) {
+				size_t iend = std::min(ti + TILE, rows);
+				size_t ib = ti + (iend - ti) / bi * bi;
+				for (size_t tj = 0; tj < cols; tj += TILE) {
+					size_t jend = std::min(tj + TILE, cols);
+					size_t jb = tj + (jend - tj) / bj * bj;
+					if (!vector) {
+						ib = ti;
+						jb = tj;
+					}
+					for (size_t j = tj; j < jb; j += bj) {
+						for (size_t i = ti; i < ib; i += bi) {
+							_CopyBlock(src + i * ls + j, ls, dst + j * ld + i, ld, stream);
+						}
+					}
+					for (size_t j = tj; j < jend; ++j) {
+						for (size_t i = j < jb ? ib : ti; i < iend; ++i) {
+							dst[j * ld + i] = src[i * ls + j];
+						}
+					}
+				}
+			}
+#ifdef DIAMOND_MATRIX_X86
+			if (stream) {
+				_mm_sfence();
+			}
+#endif
+		});
+	}
+	/**
+	 * Transpose the n x n matrix at a in place. Each thread owns a band of tile rows and
+	 * swaps every tile right of the diagonal with its mirror, so nothing is allocated.
+	 */
+	static void Square(_Td *a, const size_t &ld, const size_t &n)
+	{
+		const size_t B = _Vector() ? 32 / sizeof(_Td) : 1;
+		Parallel::For((n + TILE - 1) / TILE, TILE * n, [&](size_t begin, size_t end) {
+			for (size_t ti = begin * TILE; ti < std::min(end * TILE, n); ti += TILE) {
+				size_t iend = std::min(ti + TILE, n);
+				for (size_t tj = ti; tj < n; tj += TILE) {
+					size_t jend = std::min(tj + TILE, n);
+					size_t ib = ti, jb = tj;
+					if (B > 1) {
+						ib = ti + (iend - ti) / B * B;
+						jb = tj + (jend - tj) / B * B;
+						for (size_t I = ti; I < ib; I += B) {
+							for (size_t J = tj == ti ? I : tj; J < jb; J += B) {
+								_SwapBlock(a + I * ld + J, a + J * ld + I, ld);
+							}
+						}
+					}
+					for (size_t i = ti; i < iend; ++i) {
+						for (size_t j = std::max(tj, i + 1); j < jend; ++j) {
+							if (i >= ib || j >= jb) {
+								std::swap(a[i * ld + j], a[j * ld + i]);
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+};
+
+template<typename _Td> const size_t Transposer<_Td>::TILE;
+template<typename _Td> size_t Transposer<_Td>::streamBytes = 1 << 22;
+
+template<typename _Te>
+MatrixTransposeExpr<_Te> Transpose(const MatrixExpr<_Te> &a)
+{
+	return MatrixTransposeExpr<_Te>(a.Self());
+}
+
+template<typename _Te>
+std::ostream & operator<<(std::ostream &stream, const MatrixExpr<_Te> &expr)
+{
+	std::ostream::fmtflags oldFlags = stream.flags();
+	stream.precision(8);
+	stream.setf(std::ios::fixed | std::ios::right);
+
+	const _Te &mat = expr.Self();
+	stream << '\n';
+	for (size_t i = 0; i < mat.RowSize(); ++i) {
+		for (size_t j = 0; j < mat.ColSize(); ++j) {
+			stream << std::setw(15) << mat.At(i, j);
+		}
+		stream << '\n';
+	}
+
+	stream.flags(oldFlags);
+	return stream;
+}
+
+template<typename _Td>
+Matrix<_Td> I(const size_t &n)
+{
+	Matrix<_Td> res(n, n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		res[i][i] = static_cast<_Td>(1);
+	}
+	return res;
+}
+
+/**
+ * b is taken by value, the old signature consumed the caller's exponent.
+ * Three buffers are allocated once and the products ping-pong between them.
+ */
+template<typename _Td>
+Matrix<_Td> Pow(const Matrix<_Td> &A, size_t b)
+{
+	if (A.RowSize() != A.ColSize()) {
+		throw std::invalid_argument("The row size and column size are different.");
+	}
+	if (b == 0) {
+		return I<_Td>(A.ColSize());
+	}
+	Matrix<_Td> base(A), result, scratch(A.RowSize(), A.ColSize());
+	bool first = true;
+	while (true) {
+		if (b & static_cast<size_t>(1)) {
+			if (first) {
+				result = base;
+				first = false;
+			} else {
+				MultiplyInto(scratch, result, base);
+				std::swap(result, scratch);
+			}
+		}
+		b >>= 1;
+		if (b == 0) {
+			return result;
+		}
+		MultiplyInto(scratch, base, base);
+		std::swap(base, scratch);
+	}
+}
+
+/**
+ * Entries of an integer matrix as residues in [0, mod).
+ */
+template<typename _Td>
+Matrix<std::uint64_t> _Residues(const Matrix<_Td> &a, const std::uint64_t &mod)
+{
+	Matrix<std::uint64_t> r(a.RowSize(), a.ColSize());
+	for (size_t i = 0; i < a.RowSize(); ++i) {
+		for (size_t j = 0; j < a.ColSize(); ++j) {
+			_Td x = a[i][j];
+			if (x < 0) {
+				r[i][j] = mod - 1 - static_cast<std::uint64_t>(-(x + 1)) % mod;
+			} else {
+				r[i][j] = static_cast<std::uint64_t>(x) % mod;
+			}
+		}
+	}
+	return r;
+}
+
+template<typename _Td>
+Matrix<_Td> _FromResidues(const Matrix<std::uint64_t> &r)
+{
+	Matrix<_Td> a(r.RowSize(), r.ColSize());
+	for (size_t i = 0; i < r.RowSize(); ++i) {
+		for (size_t j = 0; j < r.ColSize(); ++j) {
+			a[i][j] = static_cast<_Td>(r[i][j]);
+		}
+	}
+	return a;
+}
+
+template<typename _Td>
+std::uint64_t _Modulus(const _Td &mod)
+{
+	static_assert(std::is_integral<_Td>::value, "modular arithmetic needs an integer type");
+	if (!(mod > 0)) {
+		throw std::invalid_argument("the modulus must be positive");
+	}
+	return static_cast<std::uint64_t>(mod);
+}
+
+/**
+ * c = a * b mod m on residues. Each row of c is summed in _Tacc and reduced only when
+ * another chunk of products could overflow it: with m below 2^32 and 64-bit sums
+ * that is every 2^64 / (m - 1)^2 terms, wider moduli sum in 128 bits.
+ */
+template<typename _Tacc>
+void _MulModRows(Matrix<std::uint64_t> &c, const Matrix<std::uint64_t> &a, const Matrix<std::uint64_t> &b, const std::uint64_t &mod)
+{
+	size_t m = a.RowSize(), n = b.ColSize(), k = a.ColSize();
+	_Tacc top = mod - 1, chunkLimit = top == 0 ? _Tacc(k) : (~_Tacc(0) - top) / (top * top);
+	size_t chunk = chunkLimit > _Tacc(k) ? k : static_cast<size_t>(chunkLimit);
+	if (chunk == 0) {
+		chunk = 1;
+	}
+	Parallel::For(m, n * k, [&](size_t begin, size_t end) {
+		std::vector<_Tacc> acc(n);
+		for (size_t i = begin; i < end; ++i) {
+			std::fill(acc.begin(), acc.end(), _Tacc(0));
+			const std::uint64_t *x = a[i];
+			size_t pending = 0;
+			for (size_t p = 0; p < k; ++p) {
+				if (x[p] == 0) {
+					continue;
+				}
+				_Tacc scale = x[p];
+				const std::uint64_t *y = b[p];
+				for (size_t j = 0; j < n; ++j) {
+					acc[j] += scale * y[j];
+				}
+				if (++pending == chunk) {
+					for (size_t j = 0; j < n; ++j) {
+						acc[j] %= mod;
+					}
+					pending = 0;
+				}
+			}
+			std::uint64_t *z = c[i];
+			for (size_t j = 0; j < n; ++j) {
+				z[j] = static_cast<std::uint64_t>(acc[j] % mod);
+			}
+		}
+	});
+}
+
+inline void _MulMod(Matrix<std::uint64_t> &c, const Matrix<std::uint64_t> &a, const Matrix<std::uint64_t> &b, const std::uint64_t &mod)
+{
+	if (c.RowSize() != a.RowSize() || c.ColSize() != b.ColSize()) {
+		c = Matrix<std::uint64_t>(a.RowSize(), b.ColSize());
+	}
+	if (mod <= (static_cast<std::uint64_t>(1) << 32)) {
+		_MulModRows<std::uint64_t>(c, a, b, mod);
+	} else {
+		_MulModRows<unsigned __int128>(c, a, b, mod);
+	}
+}
+
+/**
+ * dst = a * b mod m for integer matrices, the entries of a and b need not be reduced.
+ */
+template<typename _Td>
+Matrix<_Td> & MultiplyMod(Matrix<_Td> &dst, const Matrix<_Td> &a, const Matrix<_Td> &b, const _Td &mod)
+{
+	std::uint64_t m = _Modulus(mod);
+	if (a.ColSize() != b.RowSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	Matrix<std::uint64_t> c;
+	_MulMod(c, _Residues(a, m), _Residues(b, m), m);
+	return dst = _FromResidues<_Td>(c);
+}
+
+/**
+ * A^b mod m, the products run on residues in ping-pong buffers.
+ */
+template<typename _Td>
+Matrix<_Td> PowMod(const Matrix<_Td> &A, size_t b, const _Td &mod)
+{
+	std::uint64_t m = _Modulus(mod);
+	if (A.RowSize() != A.ColSize()) {
+		throw std::invalid_argument("The row size and column size are different.");
+	}
+	size_t n = A.RowSize();
+	Matrix<std::uint64_t> base = _Residues(A, m), result(n, n, 0), scratch(n, n);
+	for (size_t i = 0; i < n; ++i) {
+		result[i][i] = 1 % m;
+	}
+	while (b > 0) {
+		if (b & static_cast<size_t>(1)) {
+			_MulMod(scratch, result, base, m);
+			std::swap(result, scratch);
+		}
+		b >>= 1;
+		if (b > 0) {
+			_MulMod(scratch, base, base, m);
+			std::swap(base, scratch);
+		}
+	}
+	return _FromResidues<_Td>(result);
+}
+
+/**
+ * Repeated powers of one fixed matrix, optionally modulo mod.
+ * Under a prime modulus below 2^32 the characteristic polynomial p of A is found once by a
+ * Hessenberg reduction, so by Cayley-Hamilton A^b = r(A) with r = x^b mod p. r costs
+ * O(n^2 log b) and is evaluated by Paterson-Stockmeyer from the cached A^0 .. A^s,
+ * s = ceil(sqrt(n)), in about sqrt(n) products whatever b is.
+ * Otherwise the squarings A^(2^i) are cached as they are needed and a power costs one
+ * product per set bit of b.
+ * A query may grow the cache, so one object must not be shared between threads.
+ */
 template<typename _Td>
-class Matrix {
-protected:
-	size_t n_rows = 0;
-	size_t n_cols = 0;
-	std::vector<std::vector<_Td>> data;
-	class RowProxy {
-		std::vector<_Td> &row;
-	public:
-		RowProxy(std::vector<_Td> & _row) : row(_row) {}
-		_Td & operator[](const size_t &pos)
-		{
-			return row[pos];
+class MatrixPower {
+	size_t n = 0;
+	bool modular = false;
+	std::uint64_t mod = 0;
+	bool hamilton = false;
+	std::vector<Matrix<_Td>> squares;
+	std::vector<Matrix<std::uint64_t>> residues;
+	std::vector<std::uint64_t> charpoly;
+
+	static std::uint64_t _MulScalar(const std::uint64_t &x, const std::uint64_t &y, const std::uint64_t &m)
+	{
+		return static_cast<std::uint64_t>(static_cast<unsigned __int128>(x) * y % m);
+	}
+	static std::uint64_t _Inverse(std::uint64_t x, const std::uint64_t &m)
+	{
+		std::uint64_t result = 1 % m, e = m - 2;
+		for (; e > 0; e >>= 1, x = _MulScalar(x, x, m)) {
+			if (e & 1) {
+				result = _MulScalar(result, x, m);
+			}
 		}
-	};
-	class ConstRowProxy {
-		const std::vector<_Td> &row;
-	public:
-		ConstRowProxy(const std::vector<_Td> &_row) : row(_row) {}
-		const _Td & operator[](const size_t &pos) const
-		{
-			return row[pos];
+		return result;
+	}
+	static bool _IsSmallPrime(const std::uint64_t &m)
+	{
+		if (m < 2 || m > (static_cast<std::uint64_t>(1) << 32)) {
+			return false;
 		}
-	};
-public:
-	Matrix() {};
-	Matrix(const size_t &_n_rows, const size_t &_n_cols)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols))) {}
-	Matrix(const size_t &_n_rows, const size_t &_n_cols, const _Td &fillValue)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols, fillValue))) {}
-	Matrix(const Matrix<_Td> &mat)
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
-	Matrix(Matrix<_Td> &&mat) noexcept
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
-	Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
+		for (std::uint64_t d = 2; d * d <= m; ++d) {
+			if (m % d == 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+	/**
+	 * Characteristic polynomial mod a prime, low coefficient first, monic of degree n.
+	 */
+	void _CharPoly(Matrix<std::uint64_t> h)
 	{
-		this->n_rows = rhs.n_rows;
-		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
-		return *this;
+		const std::uint64_t m = mod;
+		for (size_t j = 0; j + 2 < n; ++j) {
+			size_t pivot = j + 1;
+			while (pivot < n && h[pivot][j] == 0) {
+				++pivot;
+			}
+			if (pivot == n) {
+				continue;
+			}
+			if (pivot != j + 1) {
+				for (size_t c = 0; c < n; ++c) {
+					std::swap(h[pivot][c], h[j + 1][c]);
+				}
+				for (size_t r = 0; r < n; ++r) {
+					std::swap(h[r][pivot], h[r][j + 1]);
+				}
+			}
+			std::uint64_t inverse = _Inverse(h[j + 1][j], m);
+			for (size_t i = j + 2; i < n; ++i) {
+				std::uint64_t u = _MulScalar(h[i][j], inverse, m);
+				if (u == 0) {
+					continue;
+				}
+				for (size_t c = 0; c < n; ++c) {
+					h[i][c] = (h[i][c] + m - _MulScalar(u, h[j + 1][c], m)) % m;
+				}
+				for (size_t r = 0; r < n; ++r) {
+					h[r][j + 1] = (h[r][j + 1] + _MulScalar(u, h[r][i], m)) % m;
+				}
+			}
+		}
+		std::vector<std::vector<std::uint64_t>> p(n + 1);
+		p[0].assign(1, 1 % m);
+		for (size_t k = 0; k < n; ++k) {
+			p[k + 1].assign(k + 2, 0);
+			for (size_t d = 0; d <= k; ++d) {
+				p[k + 1][d + 1] = (p[k + 1][d + 1] + p[k][d]) % m;
+				p[k + 1][d] = (p[k + 1][d] + m - _MulScalar(h[k][k], p[k][d], m)) % m;
+			}
+			std::uint64_t t = 1 % m;
+			for (size_t i = k; i > 0; --i) {
+				t = _MulScalar(t, h[i][i - 1], m);
+				std::uint64_t scale = _MulScalar(t, h[i - 1][k], m);
+				for (size_t d = 0; d < i; ++d) {
+					p[k + 1][d] = (p[k + 1][d] + m - _MulScalar(scale, p[i - 1][d], m)) % m;
+				}
+			}
+		}
+		charpoly = p[n];
 	}
-	Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+	/**
+	 * x^b mod charpoly.
+	 */
+	std::vector<std::uint64_t> _Remainder(size_t b) const
 	{
-		this->n_rows = rhs.n_rows;
-		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
-		return *this;
+		const std::uint64_t m = mod;
+		auto mulmod = [&](const std::vector<std::uint64_t> &x, const std::vector<std::uint64_t> &y) {
+			std::vector<std::uint64_t> t(2 * n, 0);
+			for (size_t i = 0; i < n; ++i) {
+				if (x[i] == 0) {
+					continue;
+				}
+				for (size_t j = 0; j < n; ++j) {
+					t[i + j] = (t[i + j] + _MulScalar(x[i], y[j], m)) % m;
+				}
+			}
+			for (size_t d = 2 * n - 1; d >= n; --d) {
+				if (t[d] == 0) {
+					continue;
+				}
+				for (size_t i = 0; i < n; ++i) {
+					t[d - n + i] = (t[d - n + i] + m - _MulScalar(t[d], charpoly[i], m)) % m;
+				}
+				t[d] = 0;
+			}
+			t.resize(n);
+			return t;
+		};
+		std::vector<std::uint64_t> result(n, 0), base(n, 0);
+		result[0] = 1 % m;
+		if (n == 1) {
+			base[0] = (m - charpoly[0]) % m;
+		} else {
+			base[1] = 1 % m;
+		}
+		for (; b > 0; b >>= 1) {
+			if (b & 1) {
+				result = mulmod(result, base);
+			}
+			if (b > 1) {
+				base = mulmod(base, base);
+			}
+		}
+		return result;
 	}
-	inline const size_t & RowSize() const
+	/**
+	 * dst = sum of r[offset + i] * A^i over the cached powers below s.
+	 * The modulus is below 2^32 here, so the sums are reduced lazily as in _MulModRows.
+	 */
+	void _Combine(Matrix<std::uint64_t> &dst, const std::vector<std::uint64_t> &r, const size_t &offset) const
 	{
-		return n_rows;
+		size_t terms = std::min(residues.size() - 1, n - offset);
+		std::uint64_t top = mod - 1;
+		size_t chunk = top == 0 ? terms : static_cast<size_t>(std::min<std::uint64_t>(terms, (~std::uint64_t(0) - top) / (top * top)));
+		Parallel::For(n, n * terms, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				std::uint64_t *z = dst[i];
+				for (size_t j = 0; j < n; ++j) {
+					z[j] = 0;
+				}
+				for (size_t t = 0; t < terms; ++t) {
+					const std::uint64_t *x = residues[t][i];
+					std::uint64_t scale = r[offset + t];
+					for (size_t j = 0; j < n; ++j) {
+						z[j] += scale * x[j];
+					}
+					if ((t + 1) % chunk == 0) {
+						for (size_t j = 0; j < n; ++j) {
+							z[j] %= mod;
+						}
+					}
+				}
+				for (size_t j = 0; j < n; ++j) {
+					z[j] %= mod;
+				}
+			}
+		});
 	}
-	inline const size_t & ColSize() const
+	void _Square(const size_t &level)
 	{
-		return n_cols;
+		while (modular ? residues.size() <= level : squares.size() <= level) {
+			if (modular) {
+				Matrix<std::uint64_t> next;
+				_MulMod(next, residues.back(), residues.back(), mod);
+				residues.push_back(std::move(next));
+			} else {
+				Matrix<_Td> next;
+				MultiplyInto(next, squares.back(), squares.back());
+				squares.push_back(std::move(next));
+			}
+		}
+	}
+public:
+	explicit MatrixPower(const Matrix<_Td> &A) : n(A.RowSize())
+	{
+		if (A.RowSize() != A.ColSize()) {
+			throw std::invalid_argument("The row size and column size are different.");
+		}
+		squares.push_back(A);
+	}
+	MatrixPower(const Matrix<_Td> &A, const _Td &_mod) : n(A.RowSize()), modular(true), mod(_Modulus(_mod))
+	{
+		if (A.RowSize() != A.ColSize()) {
+			throw std::invalid_argument("The row size and column size are different.");
+		}
+		Matrix<std::uint64_t> a = _Residues(A, mod);
+		hamilton = n > 0 && _IsSmallPrime(mod);
+		if (!hamilton) {
+			residues.push_back(std::move(a));
+			return;
+		}
+		_CharPoly(a);
+		size_t s = 1;
+		while (s * s < n) {
+			++s;
+		}
+		Matrix<std::uint64_t> identity(n, n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			identity[i][i] = 1;
+		}
+		residues.push_back(std::move(identity));
+		residues.push_back(std::move(a));
+		while (residues.size() <= s) {
+			Matrix<std::uint64_t> next;
+			_MulMod(next, residues.back(), residues[1], mod);
+			residues.push_back(std::move(next));
+		}
 	}
-	RowProxy operator[](const size_t &Kth)
+	inline size_t Size() const
 	{
-		return RowProxy(this->data[Kth]);
+		return n;
 	}
-	const ConstRowProxy operator[](const size_t &Kth) const
+	Matrix<_Td> operator()(size_t b)
 	{
-		return ConstRowProxy(this->data[Kth]);
+		if (hamilton) {
+			std::vector<std::uint64_t> r = _Remainder(b);
+			size_t s = residues.size() - 1, blocks = (n + s - 1) / s;
+			Matrix<std::uint64_t> result(n, n), scratch, part(n, n);
+			_Combine(result, r, (blocks - 1) * s);
+			for (size_t j = blocks - 1; j > 0; --j) {
+				_MulMod(scratch, result, residues[s], mod);
+				_Combine(part, r, (j - 1) * s);
+				for (size_t i = 0; i < n; ++i) {
+					for (size_t c = 0; c < n; ++c) {
+						scratch[i][c] = (scratch[i][c] + part[i][c]) % mod;
+					}
+				}
+				std::swap(result, scratch);
+			}
+			return _FromResidues<_Td>(result);
+		}
+		if (b == 0) {
+			Matrix<_Td> identity = I<_Td>(n);
+			if (modular) {
+				return _FromResidues<_Td>(_Residues(identity, mod));
+			}
+			return identity;
+		}
+		size_t level = 0;
+		while ((b >> level) > 1) {
+			++level;
+		}
+		_Square(level);
+		if (modular) {
+			Matrix<std::uint64_t> result, scratch;
+			bool first = true;
+			for (size_t i = 0; i <= level; ++i) {
+				if (!((b >> i) & 1)) {
+					continue;
+				}
+				if (first) {
+					result = residues[i];
+					first = false;
+				} else {
+					_MulMod(scratch, result, residues[i], mod);
+					std::swap(result, scratch);
+				}
+			}
+			return _FromResidues<_Td>(result);
+		}
+		Matrix<_Td> result, scratch;
+		bool first = true;
+		for (size_t i = 0; i <= level; ++i) {
+			if (!((b >> i) & 1)) {
+				continue;
+			}
+			if (first) {
+				result = squares[i];
+				first = false;
+			} else {
+				MultiplyInto(scratch, result, squares[i]);
+				std::swap(result, scratch);
+			}
+		}
+		return result;
 	}
-	~Matrix() = default;
 };
 
 /**
- * Sum of two matrics.
+ * c -= a * b, a is m x k with rows lda apart, B(p, j) is b[p * rsb + j * csb] and c is m x n.
+ * Gemm only accumulates, so the minus goes into a negated copy of a.
  */
 template<typename _Td>
-Matrix<_Td> operator+(const Matrix<_Td> &a, const Matrix<_Td> &b)
+void _SubtractProduct(const size_t &m, const size_t &n, const size_t &k, const _Td *a, const size_t &lda,
+	const _Td *b, const size_t &rsb, const size_t &csb, _Td *c, const size_t &ldc)
 {
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+	if (m == 0 || n == 0 || k == 0) {
+		return;
 	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] + b[i][j];
+	Matrix<_Td> negated(m, k);
+	for (size_t i = 0; i < m; ++i) {
+		for (size_t p = 0; p < k; ++p) {
+			negated[i][p] = -a[i * lda + p];
 		}
 	}
-	return c;
+	Gemm<_Td>::Multiply(m, n, k, negated.Data(), negated.Stride(), 1, b, rsb, csb, c, ldc);
 }
 
+/**
+ * Solve T X = B in place of x = B, T is the lower or the upper triangle of t, with a unit
+ * diagonal when unit is set. block rows of X are finished at a time and all the rows
+ * still to go are updated by one Gemm.
+ */
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &a, const Matrix<_Td> &b)
+void _SolveTriangular(const Matrix<_Td> &t, Matrix<_Td> &x, const bool &lower, const bool &unit, size_t block)
 {
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
-	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] - b[i][j];
+	size_t n = t.RowSize(), k = x.ColSize(), lt = t.Stride(), lx = x.Stride();
+	block = std::max<size_t>(block, 1);
+	size_t blocks = (n + block - 1) / block;
+	for (size_t s = 0; s < blocks; ++s) {
+		size_t b0 = (lower ? s : blocks - 1 - s) * block, b1 = std::min(n, b0 + block);
+		for (size_t step = 0; step < b1 - b0; ++step) {
+			size_t i = lower ? b0 + step : b1 - 1 - step;
+			_Td *z = x[i];
+			size_t first = lower ? b0 : i + 1, last = lower ? i : b1;
+			for (size_t p = first; p < last; ++p) {
+				const _Td f = t[i][p];
+				const _Td *y = x[p];
+				for (size_t j = 0; j < k; ++j) {
+					z[j] -= f * y[j];
+				}
+			}
+			if (!unit) {
+				const _Td inverse = static_cast<_Td>(1) / t[i][i];
+				for (size_t j = 0; j < k; ++j) {
+					z[j] *= inverse;
+				}
+			}
 		}
-	}
-	return c;
-}
-template<typename _Td>
-bool operator==(const Matrix<_Td> &a, const Matrix<_Td> &b)
-{
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		return false;
-	}
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			if (a[i][j] != b[i][j])
-				return false;
+		if (lower) {
+			_SubtractProduct(n - b1, k, b1 - b0, t.Data() + b1 * lt + b0, lt,
+				x.Data() + b0 * lx, lx, 1, x.Data() + b1 * lx, lx);
+		} else {
+			_SubtractProduct(b0, k, b1 - b0, t.Data() + b0, lt, x.Data() + b0 * lx, lx, 1, x.Data(), lx);
 		}
 	}
-	return true;
 }
 
+/**
+ * PA = LU with partial pivoting, right-looking and blocked: a panel of block columns is
+ * eliminated on its own, the matching rows of U are solved for, and the trailing matrix
+ * gets the whole panel at once through Gemm, which is where almost all the time goes.
+ * A singular matrix still factors; Solve and Inverse then throw.
+ */
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &mat)
-{
-	Matrix<_Td> result(mat.RowSize(), mat.ColSize());
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			result[i][j] = -mat[i][j];
+class LU {
+	static_assert(std::is_floating_point<_Td>::value, "LU needs a floating-point type");
+
+	Matrix<_Td> lu;
+	std::vector<size_t> perm;
+	bool odd = false;
+	bool singular = false;
+
+	void _Panel(const size_t &k0, const size_t &k1)
+	{
+		size_t n = lu.RowSize();
+		for (size_t j = k0; j < k1; ++j) {
+			size_t pivot = j;
+			_Td best = std::abs(lu[j][j]);
+			for (size_t i = j + 1; i < n; ++i) {
+				if (std::abs(lu[i][j]) > best) {
+					best = std::abs(lu[i][j]);
+					pivot = i;
+				}
+			}
+			if (best == static_cast<_Td>(0)) {
+				singular = true;
+				continue;
+			}
+			if (pivot != j) {
+				std::swap_ranges(lu[j], lu[j] + n, lu[pivot]);
+				std::swap(perm[j], perm[pivot]);
+				odd = !odd;
+			}
+			const _Td *r = lu[j];
+			const _Td inverse = static_cast<_Td>(1) / r[j];
+			for (size_t i = j + 1; i < n; ++i) {
+				_Td *s = lu[i];
+				const _Td f = s[j] *= inverse;
+				for (size_t c = j + 1; c < k1; ++c) {
+					s[c] -= f * r[c];
+				}
+			}
 		}
 	}
-	return result;
-}
+public:
+	/**
+	 * Columns per panel.
+	 */
+	static size_t block;
 
-template<typename _Td>
-Matrix<_Td> operator-(Matrix<_Td> &&mat)
-{
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			mat[i][j] = -mat[i][j];
+	explicit LU(const Matrix<_Td> &A) : lu(A), perm(A.RowSize())
+	{
+		if (A.RowSize() != A.ColSize()) {
+			throw std::invalid_argument("The row size and column size are different.");
+		}
+		size_t n = lu.RowSize(), ld = lu.Stride(), nb = std::max<size_t>(block, 1);
+		for (size_t i = 0; i < n; ++i) {
+			perm[i] = i;
+		}
+		for (size_t k0 = 0; k0 < n; k0 += nb) {
+			size_t k1 = std::min(n, k0 + nb);
+			_Panel(k0, k1);
+			for (size_t i = k0 + 1; i < k1; ++i) {
+				_Td *z = lu[i];
+				for (size_t p = k0; p < i; ++p) {
+					const _Td f = z[p];
+					const _Td *y = lu[p];
+					for (size_t j = k1; j < n; ++j) {
+						z[j] -= f * y[j];
+					}
+				}
+			}
+			_SubtractProduct(n - k1, n - k1, k1 - k0, lu.Data() + k1 * ld + k0, ld,
+				lu.Data() + k0 * ld + k1, ld, 1, lu.Data() + k1 * ld + k1, ld);
 		}
 	}
-	return mat;
-}
+	/**
+	 * L below the diagonal (its unit diagonal is not stored) and U on and above it.
+	 */
+	inline const Matrix<_Td> & Factors() const
+	{
+		return lu;
+	}
+	/**
+	 * Row i of PA is row Permutation()[i] of A.
+	 */
+	inline const std::vector<size_t> & Permutation() const
+	{
+		return perm;
+	}
+	inline bool Singular() const
+	{
+		return singular;
+	}
+	_Td Determinant() const
+	{
+		if (singular) {
+			return static_cast<_Td>(0);
+		}
+		_Td result = odd ? static_cast<_Td>(-1) : static_cast<_Td>(1);
+		for (size_t i = 0; i < lu.RowSize(); ++i) {
+			result *= lu[i][i];
+		}
+		return result;
+	}
+	/**
+	 * X with AX = B.
+	 */
+	Matrix<_Td> Solve(const Matrix<_Td> &B) const
+	{
+		if (B.RowSize() != lu.RowSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		if (singular) {
+			throw std::invalid_argument("the matrix is singular");
+		}
+		Matrix<_Td> x(B.RowSize(), B.ColSize());
+		for (size_t i = 0; i < B.RowSize(); ++i) {
+			std::copy(B[perm[i]], B[perm[i]] + B.ColSize(), x[i]);
+		}
+		_SolveTriangular(lu, x, true, true, block);
+		_SolveTriangular(lu, x, false, false, block);
+		return x;
+	}
+	Matrix<_Td> Inverse() const
+	{
+		return Solve(I<_Td>(lu.RowSize()));
+	}
+};
+
+template<typename _Td> size_t LU<_Td>::block = 64;
 
 /**
- * Multiplication of two matrics.
+ * A = LL^T for a symmetric positive definite A, blocked like LU; only the lower triangle
+ * of A is read. Throws if a pivot is not positive.
  */
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const Matrix<_Td> &b)
-{
-	if (a.ColSize() != b.RowSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
-	}
-	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < b.ColSize(); ++j) {
-			for (size_t k = 0; k < a.ColSize(); ++k) {
-				c[i][j] += a[i][k] * b[k][j];
+class Cholesky {
+	static_assert(std::is_floating_point<_Td>::value, "Cholesky needs a floating-point type");
+
+	Matrix<_Td> l;
+public:
+	/**
+	 * Columns per panel.
+	 */
+	static size_t block;
+
+	explicit Cholesky(const Matrix<_Td> &A) : l(A)
+	{
+		if (A.RowSize() != A.ColSize()) {
+			throw std::invalid_argument("The row size and column size are different.");
+		}
+		size_t n = l.RowSize(), ld = l.Stride(), nb = std::max<size_t>(block, 1);
+		for (size_t k0 = 0; k0 < n; k0 += nb) {
+			size_t k1 = std::min(n, k0 + nb);
+			auto solveRow = [&](_Td *s, const size_t &last) {
+				for (size_t j = k0; j < last; ++j) {
+					const _Td *r = l[j];
+					_Td sum = s[j];
+					for (size_t p = k0; p < j; ++p) {
+						sum -= s[p] * r[p];
+					}
+					s[j] = sum / r[j];
+				}
+			};
+			for (size_t j = k0; j < k1; ++j) {
+				_Td *r = l[j];
+				solveRow(r, j);
+				_Td d = r[j];
+				for (size_t p = k0; p < j; ++p) {
+					d -= r[p] * r[p];
+				}
+				if (!(d > static_cast<_Td>(0))) {
+					throw std::invalid_argument("the matrix is not positive definite");
+				}
+				r[j] = std::sqrt(d);
 			}
+			Parallel::For(n - k1, (k1 - k0) * (k1 - k0), [&](size_t begin, size_t end) {
+				for (size_t i = k1 + begin; i < k1 + end; ++i) {
+					solveRow(l[i], k1);
+				}
+			});
+			_SubtractProduct(n - k1, n - k1, k1 - k0, l.Data() + k1 * ld + k0, ld,
+				l.Data() + k1 * ld + k0, 1, ld, l.Data() + k1 * ld + k1, ld);
+		}
+		for (size_t i = 0; i < n; ++i) {
+			std::fill(l[i] + i + 1, l[i] + n, static_cast<_Td>(0));
 		}
 	}
-	return c;
-}
+	inline const Matrix<_Td> & L() const
+	{
+		return l;
+	}
+	_Td Determinant() const
+	{
+		_Td result = static_cast<_Td>(1);
+		for (size_t i = 0; i < l.RowSize(); ++i) {
+			result *= l[i][i] * l[i][i];
+		}
+		return result;
+	}
+	Matrix<_Td> Solve(const Matrix<_Td> &B) const
+	{
+		if (B.RowSize() != l.RowSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		Matrix<_Td> x(B);
+		_SolveTriangular(l, x, true, false, block);
+		_SolveTriangular(Matrix<_Td>(Transpose(l)), x, false, false, block);
+		return x;
+	}
+};
+
+template<typename _Td> size_t Cholesky<_Td>::block = 64;
 
 /**
- * Operations between a number and a matrix;
+ * A = QR by Householder reflections, m >= n not required. Each panel of block reflectors
+ * is kept in compact WY form I - VTV^T, so applying it to the trailing matrix, to B or
+ * to build Q is two Gemm calls around a small triangular product.
+ * The vectors v live below the diagonal with an implicit leading 1.
  */
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const _Td &b)
-{
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
+class QR {
+	static_assert(std::is_floating_point<_Td>::value, "QR needs a floating-point type");
+
+	Matrix<_Td> qr;
+	std::vector<_Td> tau;
+	std::vector<Matrix<_Td>> ts;
+
+	inline size_t _Reflectors() const
+	{
+		return std::min(qr.RowSize(), qr.ColSize());
+	}
+	/**
+	 * Householder on columns [k0, k1) and the T of their block reflector.
+	 */
+	Matrix<_Td> _Panel(const size_t &k0, const size_t &k1)
+	{
+		size_t m = qr.RowSize(), nb = k1 - k0;
+		std::vector<_Td> w(nb);
+		for (size_t j = k0; j < k1; ++j) {
+			_Td norm2 = static_cast<_Td>(0);
+			for (size_t i = j + 1; i < m; ++i) {
+				norm2 += qr[i][j] * qr[i][j];
+			}
+			if (norm2 == static_cast<_Td>(0)) {
+				tau[j] = static_cast<_Td>(0);
+				continue;
+			}
+			const _Td alpha = qr[j][j];
+			const _Td beta = -std::copysign(std::sqrt(alpha * alpha + norm2), alpha);
+			tau[j] = (beta - alpha) / beta;
+			const _Td scale = static_cast<_Td>(1) / (alpha - beta);
+			for (size_t i = j + 1; i < m; ++i) {
+				qr[i][j] *= scale;
+			}
+			qr[j][j] = beta;
+			std::copy(qr[j] + j + 1, qr[j] + k1, w.begin());
+			for (size_t i = j + 1; i < m; ++i) {
+				const _Td v = qr[i][j];
+				const _Td *s = qr[i];
+				for (size_t c = j + 1; c < k1; ++c) {
+					w[c - j - 1] += v * s[c];
+				}
+			}
+			for (size_t c = j + 1; c < k1; ++c) {
+				qr[j][c] -= tau[j] * w[c - j - 1];
+			}
+			for (size_t i = j + 1; i < m; ++i) {
+				const _Td v = tau[j] * qr[i][j];
+				_Td *s = qr[i];
+				for (size_t c = j + 1; c < k1; ++c) {
+					s[c] -= v * w[c - j - 1];
+				}
+			}
+		}
+		Matrix<_Td> t(nb, nb, 0);
+		std::vector<_Td> z(nb);
+		for (size_t j = 0; j < nb; ++j) {
+			size_t col = k0 + j;
+			t[j][j] = tau[col];
+			std::copy(qr[col] + k0, qr[col] + col, z.begin());
+			for (size_t i = col + 1; i < m; ++i) {
+				const _Td v = qr[i][col];
+				const _Td *s = qr[i];
+				for (size_t p = 0; p < j; ++p) {
+					z[p] += s[k0 + p] * v;
+				}
+			}
+			for (size_t q = 0; q < j; ++q) {
+				_Td sum = static_cast<_Td>(0);
+				for (size_t p = q; p < j; ++p) {
+					sum += t[q][p] * z[p];
+				}
+				t[q][j] = -tau[col] * sum;
+			}
 		}
+		return t;
 	}
-	return c;
-}
-
-template<typename _Td>
-Matrix<_Td> operator*(const _Td &b, const Matrix<_Td> &a)
-{
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
+	/**
+	 * Rows k0.. of the n columns at c become (I - VTV^T) c, or (I - VT^TV^T) c when
+	 * transposed, for the reflectors of columns [k0, k1); c points at row k0.
+	 */
+	void _Apply(const size_t &k0, const size_t &k1, const Matrix<_Td> &t,
+		_Td *c, const size_t &ldc, const size_t &n, const bool &transposed) const
+	{
+		size_t m = qr.RowSize() - k0, nb = k1 - k0;
+		if (n == 0) {
+			return;
+		}
+		Matrix<_Td> v(m, nb, 0), w(nb, n, 0), tw(nb, n, 0);
+		for (size_t i = 0; i < m; ++i) {
+			for (size_t j = 0; j < nb && j <= i; ++j) {
+				v[i][j] = i == j ? static_cast<_Td>(1) : qr[k0 + i][k0 + j];
+			}
+		}
+		Gemm<_Td>::Multiply(nb, n, m, v.Data(), 1, v.Stride(), c, ldc, 1, w.Data(), w.Stride());
+		for (size_t i = 0; i < nb; ++i) {
+			_Td *z = tw[i];
+			size_t first = transposed ? 0 : i, last = transposed ? i + 1 : nb;
+			for (size_t p = first; p < last; ++p) {
+				const _Td f = transposed ? t[p][i] : t[i][p];
+				const _Td *y = w[p];
+				for (size_t j = 0; j < n; ++j) {
+					z[j] += f * y[j];
+				}
+			}
 		}
+		_SubtractProduct(m, n, nb, v.Data(), v.Stride(), tw.Data(), tw.Stride(), 1, c, ldc);
 	}
-	return c;
-}
+public:
+	/**
+	 * Reflectors per panel.
+	 */
+	static size_t block;
 
-template<typename _Td>
-Matrix<_Td> operator/(const Matrix<_Td> &a, const double &b)
-{
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] / b;
+	explicit QR(const Matrix<_Td> &A) : qr(A), tau(std::min(A.RowSize(), A.ColSize()))
+	{
+		size_t n = qr.ColSize(), ld = qr.Stride(), nb = std::max<size_t>(block, 1), r = _Reflectors();
+		for (size_t k0 = 0; k0 < r; k0 += nb) {
+			size_t k1 = std::min(r, k0 + nb);
+			ts.push_back(_Panel(k0, k1));
+			_Apply(k0, k1, ts.back(), qr.Data() + k0 * ld + k1, ld, n - k1, true);
 		}
 	}
-	return c;
-}
-
-template<typename _Td>
-Matrix<_Td> Transpose(const Matrix<_Td> &a)
-{
-	Matrix<_Td> res(a.ColSize(), a.RowSize());
-	for (size_t i = 0; i < a.ColSize(); ++i) {
-		for (size_t j = 0; j < a.RowSize(); ++j) {
-			res[i][j] = a[j][i];
+	/**
+	 * The m x m orthogonal factor.
+	 */
+	Matrix<_Td> Q() const
+	{
+		size_t m = qr.RowSize(), nb = std::max<size_t>(block, 1);
+		Matrix<_Td> q = I<_Td>(m);
+		for (size_t b = ts.size(); b-- > 0;) {
+			size_t k0 = b * nb, k1 = std::min(_Reflectors(), k0 + nb);
+			_Apply(k0, k1, ts[b], q.Data() + k0 * q.Stride() + k0, q.Stride(), m - k0, false);
 		}
+		return q;
 	}
-	return res;
-}
+	/**
+	 * The m x n upper triangular factor.
+	 */
+	Matrix<_Td> R() const
+	{
+		Matrix<_Td> r(qr.RowSize(), qr.ColSize(), 0);
+		for (size_t i = 0; i < qr.RowSize(); ++i) {
+			for (size_t j = i; j < qr.ColSize(); ++j) {
+				r[i][j] = qr[i][j];
+			}
+		}
+		return r;
+	}
+	/**
+	 * The least squares solution of AX = B, which is the solution when A is square.
+	 * A needs m >= n and full column rank.
+	 */
+	Matrix<_Td> Solve(const Matrix<_Td> &B) const
+	{
+		size_t m = qr.RowSize(), n = qr.ColSize(), nb = std::max<size_t>(block, 1);
+		if (B.RowSize() != m || m < n) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		Matrix<_Td> y(B);
+		for (size_t b = 0; b < ts.size(); ++b) {
+			size_t k0 = b * nb, k1 = std::min(_Reflectors(), k0 + nb);
+			_Apply(k0, k1, ts[b], y.Data() + k0 * y.Stride(), y.Stride(), y.ColSize(), true);
+		}
+		Matrix<_Td> r(n, n, 0), x(n, B.ColSize());
+		for (size_t i = 0; i < n; ++i) {
+			if (qr[i][i] == static_cast<_Td>(0)) {
+				throw std::invalid_argument("the matrix is singular");
+			}
+			std::copy(qr[i] + i, qr[i] + n, r[i] + i);
+			std::copy(y[i], y[i] + B.ColSize(), x[i]);
+		}
+		_SolveTriangular(r, x, false, false, nb);
+		return x;
+	}
+};
 
+template<typename _Td> size_t QR<_Td>::block = 32;
+
+/**
+ * X with AX = B: LU for a square A, least squares by QR for a tall one.
+ */
 template<typename _Td>
-std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
+Matrix<_Td> Solve(const Matrix<_Td> &A, const Matrix<_Td> &B)
 {
-	std::ostream::fmtflags oldFlags = stream.flags();
-	stream.precision(8);
-	stream.setf(std::ios::fixed | std::ios::right);
-
-	stream << '\n';
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			stream << std::setw(15) << mat[i][j];
-		}
-		stream << '\n';
+	if (A.RowSize() == A.ColSize()) {
+		return LU<_Td>(A).Solve(B);
 	}
-
-	stream.flags(oldFlags);
-	return stream;
+	return QR<_Td>(A).Solve(B);
 }
 
 template<typename _Td>
-Matrix<_Td> I(const size_t &n)
+_Td Determinant(const Matrix<_Td> &A)
 {
-	Matrix<_Td> res(n, n, 0);
-	for (size_t i = 0; i < n; ++i) {
-		res[i][i] = static_cast<_Td>(1);
-	}
-	return res;
+	return LU<_Td>(A).Determinant();
 }
 
 template<typename _Td>
-Matrix<_Td> Pow(Matrix<_Td> A, size_t &b)
+Matrix<_Td> Inverse(const Matrix<_Td> &A)
 {
-	if (A.RowSize() != A.ColSize()) {
-		throw std::invalid_argument("The row size and column size are different.");
-	}
-	Matrix<_Td> result = I<_Td>(A.ColSize());
-	while (b > 0) {
-		if (b & static_cast<size_t>(1)) {
-			result = result * A;
-		}
-		A = A * A;
-		b = b >> static_cast<size_t>(1);
-	}
-	return result;
+	return LU<_Td>(A).Inverse();
 }
 
 }
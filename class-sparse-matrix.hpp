@@ -0,0 +1,445 @@
+#ifndef DIAMOND_SPARSE_MATRIX_HPP
+#define DIAMOND_SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "class-matrix.hpp"
+
+namespace Diamond {
+
+/**
+ * A compressed sparse matrix. In CSR, ptr holds n_rows + 1 offsets into idx (column indices)
+ * and values, one run per row; CSC is the same with rows and columns swapped.
+ * Inside a run the indices are strictly increasing. Memory and the cost of every operation
+ * grow with the number of non-zeros, never with n_rows * n_cols.
+ */
+template<typename _Td>
+class SparseMatrix {
+public:
+	enum Format { CSR, CSC };
+	/**
+	 * One entry in coordinate (COO) form.
+	 */
+	struct Triplet {
+		size_t row;
+		size_t col;
+		_Td value;
+	};
+protected:
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	Format format = CSR;
+	std::vector<size_t> ptr;
+	std::vector<size_t> idx;
+	std::vector<_Td> values;
+
+	inline size_t _Major() const
+	{
+		return format == CSR ? n_rows : n_cols;
+	}
+	inline size_t _Minor() const
+	{
+		return format == CSR ? n_cols : n_rows;
+	}
+	/**
+	 * Two stable counting sorts, by the minor index and then by the major one,
+	 * leave the entries ordered by (major, minor); duplicates are then summed.
+	 */
+	void _Build(const std::vector<size_t> &major, const std::vector<size_t> &minor, const std::vector<_Td> &vals)
+	{
+		size_t nnz = vals.size(), majorSize = _Major(), minorSize = _Minor();
+		std::vector<size_t> count(minorSize + 1, 0), order(nnz), sorted(nnz);
+		for (size_t t = 0; t < nnz; ++t) {
+			++count[minor[t] + 1];
+		}
+		for (size_t m = 0; m < minorSize; ++m) {
+			count[m + 1] += count[m];
+		}
+		for (size_t t = 0; t < nnz; ++t) {
+			order[count[minor[t]]++] = t;
+		}
+		ptr.assign(majorSize + 1, 0);
+		for (size_t t = 0; t < nnz; ++t) {
+			++ptr[major[t] + 1];
+		}
+		for (size_t m = 0; m < majorSize; ++m) {
+			ptr[m + 1] += ptr[m];
+		}
+		std::vector<size_t> cursor(ptr.begin(), ptr.end() - 1);
+		for (size_t t : order) {
+			sorted[cursor[major[t]]++] = t;
+		}
+		idx.clear();
+		values.clear();
+		idx.reserve(nnz);
+		values.reserve(nnz);
+		size_t from = 0;
+		for (size_t m = 0; m < majorSize; ++m) {
+			size_t start = idx.size();
+			for (; from < ptr[m + 1]; ++from) {
+				size_t t = sorted[from];
+				if (idx.size() > start && idx.back() == minor[t]) {
+					values.back() += vals[t];
+				} else {
+					idx.push_back(minor[t]);
+					values.push_back(vals[t]);
+				}
+			}
+			ptr[m] = start;
+		}
+		ptr[majorSize] = idx.size();
+	}
+	/**
+	 * Cut the major runs into one part per thread with about the same number of
+	 * non-zeros each and call f(begin, end) on the runs of every part.
+	 */
+	template<typename _Tf>
+	void _ForRuns(const size_t &costPerNonZero, _Tf f) const
+	{
+		size_t majorSize = _Major(), nnz = NonZeros();
+		size_t parts = std::max<size_t>(1, std::min<size_t>(Parallel::threadCount, majorSize));
+		auto bound = [&](size_t p) -> size_t {
+			if (p == parts) {
+				return majorSize;
+			}
+			return std::lower_bound(ptr.begin(), ptr.end() - 1, nnz * p / parts) - ptr.begin();
+		};
+		Parallel::For(parts, std::max<size_t>(nnz, majorSize) * costPerNonZero / parts, [&](size_t begin, size_t end) {
+			for (size_t p = begin; p < end; ++p) {
+				size_t first = p == 0 ? 0 : bound(p), last = bound(p + 1);
+				if (first < last) {
+					f(first, last);
+				}
+			}
+		});
+	}
+public:
+	SparseMatrix() : ptr(1, 0) {}
+	SparseMatrix(const size_t &_n_rows, const size_t &_n_cols, const Format &_format = CSR)
+		: n_rows(_n_rows), n_cols(_n_cols), format(_format), ptr(_Major() + 1, 0) {}
+	/**
+	 * Build from COO triplets in any order, entries at the same position are summed.
+	 */
+	SparseMatrix(const size_t &_n_rows, const size_t &_n_cols, const std::vector<Triplet> &triplets, const Format &_format = CSR)
+		: n_rows(_n_rows), n_cols(_n_cols), format(_format)
+	{
+		std::vector<size_t> major(triplets.size()), minor(triplets.size());
+		std::vector<_Td> vals(triplets.size());
+		for (size_t t = 0; t < triplets.size(); ++t) {
+			if (triplets[t].row >= n_rows || triplets[t].col >= n_cols) {
+				throw std::invalid_argument("the index is out of the matrix");
+			}
+			major[t] = format == CSR ? triplets[t].row : triplets[t].col;
+			minor[t] = format == CSR ? triplets[t].col : triplets[t].row;
+			vals[t] = triplets[t].value;
+		}
+		_Build(major, minor, vals);
+	}
+	/**
+	 * Keep the elements of a dense matrix that are not zero.
+	 */
+	explicit SparseMatrix(const Matrix<_Td> &mat, const Format &_format = CSR)
+		: n_rows(mat.RowSize()), n_cols(mat.ColSize()), format(_format), ptr(_Major() + 1, 0)
+	{
+		const _Td zero = static_cast<_Td>(0);
+		for (size_t m = 0; m < _Major(); ++m) {
+			for (size_t n = 0; n < _Minor(); ++n) {
+				const _Td &value = format == CSR ? mat[m][n] : mat[n][m];
+				if (value != zero) {
+					idx.push_back(n);
+					values.push_back(value);
+				}
+			}
+			ptr[m + 1] = idx.size();
+		}
+	}
+	inline size_t RowSize() const
+	{
+		return n_rows;
+	}
+	inline size_t ColSize() const
+	{
+		return n_cols;
+	}
+	inline Format Layout() const
+	{
+		return format;
+	}
+	inline size_t NonZeros() const
+	{
+		return idx.size();
+	}
+	/**
+	 * The compressed arrays, see the class comment.
+	 */
+	inline const std::vector<size_t> & Ptr() const
+	{
+		return ptr;
+	}
+	inline const std::vector<size_t> & Indices() const
+	{
+		return idx;
+	}
+	inline const std::vector<_Td> & Values() const
+	{
+		return values;
+	}
+	/**
+	 * Element (i, j), zero when it is not stored. O(log) in the length of the run.
+	 */
+	_Td At(const size_t &i, const size_t &j) const
+	{
+		if (i >= n_rows || j >= n_cols) {
+			throw std::invalid_argument("the index is out of the matrix");
+		}
+		size_t m = format == CSR ? i : j, n = format == CSR ? j : i;
+		auto first = idx.begin() + ptr[m], last = idx.begin() + ptr[m + 1];
+		auto it = std::lower_bound(first, last, n);
+		if (it == last || *it != n) {
+			return static_cast<_Td>(0);
+		}
+		return values[it - idx.begin()];
+	}
+	/**
+	 * The same matrix in the given layout; a change of layout is one counting sort.
+	 */
+	SparseMatrix<_Td> Convert(const Format &target) const
+	{
+		if (target == format) {
+			return *this;
+		}
+		SparseMatrix<_Td> result(n_rows, n_cols, target);
+		size_t minorSize = _Minor();
+		std::vector<size_t> &rptr = result.ptr;
+		for (size_t t = 0; t < idx.size(); ++t) {
+			++rptr[idx[t] + 1];
+		}
+		for (size_t n = 0; n < minorSize; ++n) {
+			rptr[n + 1] += rptr[n];
+		}
+		result.idx.resize(idx.size());
+		result.values.resize(values.size());
+		std::vector<size_t> cursor(rptr.begin(), rptr.end() - 1);
+		for (size_t m = 0; m < _Major(); ++m) {
+			for (size_t t = ptr[m]; t < ptr[m + 1]; ++t) {
+				size_t to = cursor[idx[t]]++;
+				result.idx[to] = m;
+				result.values[to] = values[t];
+			}
+		}
+		return result;
+	}
+	std::vector<Triplet> Triplets() const
+	{
+		std::vector<Triplet> result;
+		result.reserve(NonZeros());
+		for (size_t m = 0; m < _Major(); ++m) {
+			for (size_t t = ptr[m]; t < ptr[m + 1]; ++t) {
+				if (format == CSR) {
+					result.push_back(Triplet{m, idx[t], values[t]});
+				} else {
+					result.push_back(Triplet{idx[t], m, values[t]});
+				}
+			}
+		}
+		return result;
+	}
+	Matrix<_Td> ToDense() const
+	{
+		Matrix<_Td> result(n_rows, n_cols, 0);
+		for (size_t m = 0; m < _Major(); ++m) {
+			for (size_t t = ptr[m]; t < ptr[m + 1]; ++t) {
+				if (format == CSR) {
+					result[m][idx[t]] = values[t];
+				} else {
+					result[idx[t]][m] = values[t];
+				}
+			}
+		}
+		return result;
+	}
+	/**
+	 * The transpose keeps the arrays and swaps the layout: CSR of A is CSC of A^T.
+	 * A copy costs O(nnz), a temporary gives its arrays away.
+	 */
+	friend SparseMatrix<_Td> Transpose(const SparseMatrix<_Td> &a)
+	{
+		return Transpose(SparseMatrix<_Td>(a));
+	}
+	friend SparseMatrix<_Td> Transpose(SparseMatrix<_Td> &&a)
+	{
+		SparseMatrix<_Td> result(std::move(a));
+		std::swap(result.n_rows, result.n_cols);
+		result.format = result.format == CSR ? CSC : CSR;
+		return result;
+	}
+
+	/**
+	 * SpMV. CSR rows are split over the threads; CSC scatters column by column on one thread.
+	 */
+	friend std::vector<_Td> operator*(const SparseMatrix<_Td> &a, const std::vector<_Td> &x)
+	{
+		if (a.n_cols != x.size()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		std::vector<_Td> y(a.n_rows, static_cast<_Td>(0));
+		if (a.format == CSR) {
+			a._ForRuns(1, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					_Td sum = static_cast<_Td>(0);
+					for (size_t t = a.ptr[i]; t < a.ptr[i + 1]; ++t) {
+						sum += a.values[t] * x[a.idx[t]];
+					}
+					y[i] = sum;
+				}
+			});
+		} else {
+			for (size_t j = 0; j < a.n_cols; ++j) {
+				for (size_t t = a.ptr[j]; t < a.ptr[j + 1]; ++t) {
+					y[a.idx[t]] += a.values[t] * x[j];
+				}
+			}
+		}
+		return y;
+	}
+	/**
+	 * SpMM, sparse x dense. A CSR row of the result is a sum of rows of b scaled by that row's
+	 * non-zeros, and rows are split over the threads; with CSC the threads split the columns
+	 * of the result instead, so every element is still written by one thread.
+	 */
+	friend Matrix<_Td> operator*(const SparseMatrix<_Td> &a, const Matrix<_Td> &b)
+	{
+		if (a.n_cols != b.RowSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		size_t n = b.ColSize();
+		Matrix<_Td> c(a.n_rows, n, 0);
+		if (a.format == CSR) {
+			a._ForRuns(n, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					_Td *z = c[i];
+					for (size_t t = a.ptr[i]; t < a.ptr[i + 1]; ++t) {
+						const _Td &v = a.values[t];
+						const _Td *y = b[a.idx[t]];
+						for (size_t j = 0; j < n; ++j) {
+							z[j] += v * y[j];
+						}
+					}
+				}
+			});
+		} else {
+			Parallel::For(n, a.NonZeros(), [&](size_t begin, size_t end) {
+				for (size_t k = 0; k < a.n_cols; ++k) {
+					const _Td *y = b[k];
+					for (size_t t = a.ptr[k]; t < a.ptr[k + 1]; ++t) {
+						const _Td &v = a.values[t];
+						_Td *z = c[a.idx[t]];
+						for (size_t j = begin; j < end; ++j) {
+							z[j] += v * y[j];
+						}
+					}
+				}
+			});
+		}
+		return c;
+	}
+	/**
+	 * Dense x sparse, split by the rows of a.
+	 */
+	friend Matrix<_Td> operator*(const Matrix<_Td> &a, const SparseMatrix<_Td> &b)
+	{
+		if (a.ColSize() != b.n_rows) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		Matrix<_Td> c(a.RowSize(), b.n_cols, 0);
+		Parallel::For(a.RowSize(), std::max<size_t>(b.NonZeros(), 1), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const _Td *x = a[i];
+				_Td *z = c[i];
+				for (size_t m = 0; m < b._Major(); ++m) {
+					for (size_t t = b.ptr[m]; t < b.ptr[m + 1]; ++t) {
+						if (b.format == CSR) {
+							z[b.idx[t]] += x[m] * b.values[t];
+						} else {
+							z[m] += x[b.idx[t]] * b.values[t];
+						}
+					}
+				}
+			}
+		});
+		return c;
+	}
+	/**
+	 * Sparse x sparse by Gustavson's row-by-row method, the result is CSR.
+	 * A symbolic pass counts the non-zeros of every row so the numeric pass can write
+	 * its rows in parallel straight into place; each thread keeps one dense accumulator
+	 * row and a marker row, and the few columns a row touches are sorted afterwards.
+	 */
+	friend SparseMatrix<_Td> operator*(const SparseMatrix<_Td> &lhs, const SparseMatrix<_Td> &rhs)
+	{
+		if (lhs.n_cols != rhs.n_rows) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		SparseMatrix<_Td> lhsCSR, rhsCSR;
+		if (lhs.format != CSR) {
+			lhsCSR = lhs.Convert(CSR);
+		}
+		if (rhs.format != CSR) {
+			rhsCSR = rhs.Convert(CSR);
+		}
+		const SparseMatrix<_Td> &a = lhs.format == CSR ? lhs : lhsCSR;
+		const SparseMatrix<_Td> &b = rhs.format == CSR ? rhs : rhsCSR;
+		SparseMatrix<_Td> c(a.n_rows, b.n_cols, CSR);
+		size_t n = b.n_cols;
+		std::vector<size_t> rowSize(a.n_rows, 0);
+		a._ForRuns(1, [&](size_t begin, size_t end) {
+			std::vector<size_t> mark(n, static_cast<size_t>(-1));
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t t = a.ptr[i]; t < a.ptr[i + 1]; ++t) {
+					size_t k = a.idx[t];
+					for (size_t s = b.ptr[k]; s < b.ptr[k + 1]; ++s) {
+						if (mark[b.idx[s]] != i) {
+							mark[b.idx[s]] = i;
+							++rowSize[i];
+						}
+					}
+				}
+			}
+		});
+		for (size_t i = 0; i < a.n_rows; ++i) {
+			c.ptr[i + 1] = c.ptr[i] + rowSize[i];
+		}
+		c.idx.resize(c.ptr[a.n_rows]);
+		c.values.resize(c.ptr[a.n_rows]);
+		a._ForRuns(1, [&](size_t begin, size_t end) {
+			std::vector<size_t> mark(n, static_cast<size_t>(-1));
+			std::vector<_Td> acc(n, static_cast<_Td>(0));
+			for (size_t i = begin; i < end; ++i) {
+				size_t *cols = c.idx.data() + c.ptr[i], used = 0;
+				for (size_t t = a.ptr[i]; t < a.ptr[i + 1]; ++t) {
+					size_t k = a.idx[t];
+					const _Td &v = a.values[t];
+					for (size_t s = b.ptr[k]; s < b.ptr[k + 1]; ++s) {
+						size_t j = b.idx[s];
+						if (mark[j] != i) {
+							mark[j] = i;
+							cols[used++] = j;
+							acc[j] = v * b.values[s];
+						} else {
+							acc[j] += v * b.values[s];
+						}
+					}
+				}
+				std::sort(cols, cols + used);
+				for (size_t u = 0; u < used; ++u) {
+					c.values[c.ptr[i] + u] = acc[cols[u]];
+				}
+			}
+		});
+		return c;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,213 @@
+#ifndef SJTU_CONCURRENT_MAP_HPP
+#define SJTU_CONCURRENT_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * a map shared by many threads.
+ * keys are hash-partitioned over several sjtu::map shards, each with its own reader-writer lock,
+ *   so operations on different shards never wait for each other.
+ * nothing returns a reference or an iterator into a shard, values are copied out under the lock.
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class Compare = std::less<Key>>
+class concurrent_map {
+public:
+	typedef pair<const Key, T> value_type;
+	typedef map<Key, T, Compare> shard_type;
+private:
+	typedef std::shared_timed_mutex lock_type;
+	typedef std::unique_lock<lock_type> write_guard;
+	typedef std::shared_lock<lock_type> read_guard;
+
+	struct shard {
+		lock_type lock;
+		shard_type map;
+		char padding[64]; // keep the lock of the next shard off this cache line
+	};
+
+	size_t shard_count;
+	shard *shards;
+	Hash hash;
+	Compare compare;
+
+	size_t shard_of(const Key &key) const {
+		// mix in 64 bits whatever the width of size_t, std::hash is the identity for integers
+		std::uint64_t h = hash(key);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return static_cast<size_t>(h % shard_count);
+	}
+public:
+	explicit concurrent_map(size_t shard_count = 64) :
+		shard_count(shard_count == 0 ? 1 : shard_count), shards(new shard[this->shard_count]), hash(), compare() {}
+	concurrent_map(const concurrent_map &other) = delete;
+	concurrent_map &operator=(const concurrent_map &other) = delete;
+	~concurrent_map() {
+		delete[] shards;
+	}
+
+	/**
+	 * copy the mapped value of key into result, return false if there is no such key.
+	 */
+	bool find(const Key &key, T &result) const {
+		shard &target = shards[shard_of(key)];
+		read_guard guard(target.lock);
+		const shard_type &map = target.map;
+		typename shard_type::const_iterator it = map.find(key);
+		if (it == map.cend()) return false;
+		result = it->second;
+		return true;
+	}
+	size_t count(const Key &key) const {
+		shard &target = shards[shard_of(key)];
+		read_guard guard(target.lock);
+		return target.map.count(key);
+	}
+	/**
+	 * insert value, return false if the key already exists.
+	 */
+	bool insert(const value_type &value) {
+		shard &target = shards[shard_of(value.first)];
+		write_guard guard(target.lock);
+		return target.map.insert(value).second;
+	}
+	/**
+	 * return the number of elements erased, which is either 1 or 0.
+	 */
+	size_t erase(const Key &key) {
+		shard &target = shards[shard_of(key)];
+		write_guard guard(target.lock);
+		typename shard_type::iterator it = target.map.find(key);
+		if (it == target.map.end()) return 0;
+		target.map.erase(it);
+		return 1;
+	}
+	/**
+	 * the size is summed shard by shard, it is exact only when there is no writer.
+	 */
+	size_t size() const {
+		size_t result = 0;
+		for (size_t i = 0; i < shard_count; ++i) {
+			read_guard guard(shards[i].lock);
+			result += shards[i].map.size();
+		}
+		return result;
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	void clear() {
+		for (size_t i = 0; i < shard_count; ++i) {
+			write_guard guard(shards[i].lock);
+			shards[i].map.clear();
+		}
+	}
+
+	/**
+	 * look up n keys, taking the lock of each shard only once.
+	 * the keys are grouped by shard first, found[i] tells whether values[i] is filled.
+	 * return the number of keys found.
+	 */
+	size_t find_batch(const Key *keys, size_t n, T *values, bool *found) const {
+		std::vector<size_t> start(shard_count + 1, 0), order(n), owner(n);
+		for (size_t i = 0; i < n; ++i) {
+			owner[i] = shard_of(keys[i]);
+			++start[owner[i] + 1];
+		}
+		for (size_t i = 0; i < shard_count; ++i) start[i + 1] += start[i];
+		std::vector<size_t> cursor(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < n; ++i) order[cursor[owner[i]]++] = i;
+		size_t result = 0;
+		for (size_t s = 0; s < shard_count; ++s) {
+			if (start[s] == start[s + 1]) continue;
+			read_guard guard(shards[s].lock);
+			const shard_type &map = shards[s].map;
+			for (size_t j = start[s]; j < start[s + 1]; ++j) {
+				size_t i = order[j];
+				typename shard_type::const_iterator it = map.find(keys[i]);
+				found[i] = it != map.cend();
+				if (found[i]) {
+					values[i] = it->second;
+					++result;
+				}
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * call f(index, shard) for every shard under its read lock, one shard at a time.
+	 */
+	template <class Function> void for_each_shard(Function f) const {
+		for (size_t i = 0; i < shard_count; ++i) {
+			read_guard guard(shards[i].lock);
+			f(i, static_cast<const shard_type &>(shards[i].map));
+		}
+	}
+	/**
+	 * call f(index, shard) for every shard under its write lock, one shard at a time.
+	 */
+	template <class Function> void modify_each_shard(Function f) {
+		for (size_t i = 0; i < shard_count; ++i) {
+			write_guard guard(shards[i].lock);
+			f(i, shards[i].map);
+		}
+	}
+
+	/**
+	 * call f(value) for all the elements in key order.
+	 * every shard is read-locked for the whole walk, which is a k-way merge over the shards
+	 *   driven by a binary heap of the shard cursors.
+	 */
+	template <class Function> void merge_iterate(Function f) const {
+		std::vector<read_guard> guards;
+		guards.reserve(shard_count);
+		for (size_t i = 0; i < shard_count; ++i) guards.emplace_back(shards[i].lock);
+		typedef typename shard_type::const_iterator cursor_type;
+		std::vector<cursor_type> cursor(shard_count);
+		std::vector<size_t> heap;
+		heap.reserve(shard_count);
+		auto less = [&](size_t a, size_t b) {
+			return compare(cursor[a]->first, cursor[b]->first);
+		};
+		auto sift_down = [&](size_t pos) {
+			while (true) {
+				size_t smallest = pos, left = pos * 2 + 1, right = pos * 2 + 2;
+				if (left < heap.size() && less(heap[left], heap[smallest])) smallest = left;
+				if (right < heap.size() && less(heap[right], heap[smallest])) smallest = right;
+				if (smallest == pos) return;
+				size_t temp = heap[pos];
+				heap[pos] = heap[smallest];
+				heap[smallest] = temp;
+				pos = smallest;
+			}
+		};
+		for (size_t i = 0; i < shard_count; ++i) {
+			cursor[i] = shards[i].map.cbegin();
+			if (cursor[i] != shards[i].map.cend()) heap.push_back(i);
+		}
+		for (size_t i = heap.size(); i > 0; --i) sift_down(i - 1);
+		while (!heap.empty()) {
+			size_t top = heap[0];
+			f(*cursor[top]);
+			if (++cursor[top] == shards[top].map.cend()) {
+				heap[0] = heap.back();
+				heap.pop_back();
+			}
+			sift_down(0);
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "concurrent_map.hpp"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+typedef sjtu::concurrent_map<int, long long> map_t;
+
+void writer(map_t &map, int id) {
+	for (int i = 0; i < 50000; ++i) {
+		int key = i * 8 + id;
+		bool inserted = map.insert(map_t::value_type(key, 1LL * key * key));
+		bool duplicated = map.insert(map_t::value_type(key, 0));
+		size_t erased = i % 3 == 0 ? map.erase(key) : 1;
+		long long value = 1LL * key * key;
+		bool found = map.find(key, value);
+		// the calls above are not inside assert, so NDEBUG builds still do every write
+		assert(inserted && !duplicated && erased == 1);
+		assert(found == (i % 3 != 0) && value == 1LL * key * key);
+		(void)inserted, (void)duplicated, (void)erased, (void)found;
+	}
+}
+
+int main() {
+	map_t map(16);
+	std::vector<std::thread> threads;
+	for (int id = 0; id < 8; ++id) threads.emplace_back(writer, std::ref(map), id);
+	for (auto &thread : threads) thread.join();
+	std::cout << map.size() << std::endl;
+
+	int last = -1;
+	long long checksum = 0;
+	size_t counter = 0;
+	map.merge_iterate([&](const map_t::value_type &value) {
+		assert(value.first > last);
+		last = value.first;
+		checksum = (checksum * 131 + value.second) % 1000000007;
+		if ((++counter) % 10007 == 0) std::cout << value.first << " ";
+	});
+	std::cout << counter << " " << checksum << std::endl;
+
+	std::vector<int> keys;
+	for (int i = 0; i < 10000; ++i) keys.push_back(i * 37 % 400000);
+	std::vector<long long> values(keys.size());
+	bool *found = new bool[keys.size()];
+	size_t hit = map.find_batch(keys.data(), keys.size(), values.data(), found);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		assert(found[i] == (map.count(keys[i]) == 1));
+		if (found[i]) assert(values[i] == 1LL * keys[i] * keys[i]);
+	}
+	delete[] found;
+	std::cout << hit << std::endl;
+
+	size_t total = 0;
+	map.for_each_shard([&](size_t, const map_t::shard_type &shard) {
+		total += shard.size();
+	});
+	std::cout << (total == map.size()) << std::endl;
+	map.modify_each_shard([](size_t index, map_t::shard_type &shard) {
+		if (index % 2 == 0) shard.clear();
+	});
+	std::cout << map.size() << std::endl;
+	map.clear();
+	std::cout << map.empty() << std::endl;
+	return 0;
+}
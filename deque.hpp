@@ -118,6 +118,37 @@ private:
 private:
 	list *head, *tail;
 
+	/**
+	 * unlink all the blocks of other into first..last, other becomes empty.
+	 * other must not be empty.
+	 */
+	static void __take(deque &other, list *&first, list *&last) {
+		first = other.head->next;
+		last = other.tail->prev;
+		other.head->next = other.tail;
+		other.tail->prev = other.head;
+		other.__size = 0;
+	}
+	/**
+	 * link the chain of blocks first..last right after left.
+	 */
+	static void __link(list *left, list *first, list *last) {
+		last->next = left->next;
+		left->next->prev = last;
+		left->next = first;
+		first->prev = left;
+	}
+	/**
+	 * merge left and the block after it if they fit in one block, as push_back would have filled them.
+	 * return whether they are merged.
+	 */
+	bool __mend(list *left) {
+		if (left == head || left == tail || left->next == tail) return false;
+		if (left->size + left->next->size > __block_size()) return false;
+		left->__merge();
+		return true;
+	}
+
 public:
 	class iterator;
 	class const_iterator;
@@ -126,6 +157,12 @@ public:
 		head->next = tail;
 		tail->prev = head;
 	}
+	/**
+	 * take the blocks of other, other becomes empty.
+	 */
+	deque(deque &&other) : deque() {
+		append(static_cast<deque &&>(other));
+	}
 	deque(const deque &other) : head(new list), tail(new list), __size(other.__size) {
 		head->next = tail;
 		tail->prev = head;
@@ -161,6 +198,12 @@ public:
 		}
 		return *this;
 	}
+	deque &operator=(deque &&other) {
+		if (this == &other) return *this;
+		clear();
+		append(static_cast<deque &&>(other));
+		return *this;
+	}
 	/**
 	 * access specified element with bounds checking
 	 * throw index_out_of_bound if out of bound.
@@ -441,12 +484,97 @@ public:
 			delete old_node;
 		}
 	}
+	/**
+	 * move all the elements of other to the end, other becomes empty.
+	 * no element is copied: the blocks of other are relinked and only the two blocks at the seam may be merged.
+	 * iterators of other are invalidated.
+	 */
+	void append(deque &&other) {
+		if (&other == this || other.__size == 0) return;
+		list *seam = tail->prev, *first, *last;
+		__size += other.__size;
+		__take(other, first, last);
+		__link(seam, first, last);
+		__mend(seam);
+	}
+	/**
+	 * move all the elements of other to the beginning, other becomes empty.
+	 * iterators of other are invalidated.
+	 */
+	void prepend(deque &&other) {
+		if (&other == this || other.__size == 0) return;
+		list *first, *last;
+		__size += other.__size;
+		__take(other, first, last);
+		__link(head, first, last);
+		__mend(last);
+	}
+	/**
+	 * cut the deque at pos: the elements in [pos, size) are moved to the returned deque, [0, pos) are kept.
+	 * it costs one walk over the blocks and at most one block split.
+	 * throw index_out_of_bound if pos > size.
+	 */
+	deque split_off(const size_t &pos) {
+		if (pos > __size) throw index_out_of_bound();
+		deque result;
+		list *cut = head->next;
+		size_t now_pos = 0;
+		while (cut != tail && now_pos + cut->size <= pos) {
+			now_pos += cut->size;
+			cut = cut->next;
+		}
+		if (cut == tail) return result;
+		if (now_pos < pos) {
+			cut->__split(pos - now_pos);
+			cut = cut->next;
+		}
+		list *last = tail->prev;
+		cut->prev->next = tail;
+		tail->prev = cut->prev;
+		__link(result.head, cut, last);
+		result.__size = __size - pos;
+		__size = pos;
+		if (tail->prev != head) __mend(tail->prev->prev);
+		result.__mend(result.head->next);
+		return result;
+	}
+	/**
+	 * move all the elements of other before pos, other becomes empty.
+	 * the block holding pos is split there, the blocks of other are linked in between,
+	 *   and each of the two seams may be merged.
+	 * returns an iterator pointing to the first moved element, or pos if other is empty.
+	 * iterators of other and iterators into the block holding pos are invalidated.
+	 *     throw if the iterator is invalid or other is this deque.
+	 */
+	iterator splice(iterator pos, deque &&other) {
+		if (pos.__deque != this || &other == this) throw invalid_iterator();
+		if (other.__size == 0) return pos;
+		list *left = pos.__list->prev;
+		if (pos.__list != tail) {
+			size_t offset = 0;
+			for (node *p = pos.__list->head->next; p != pos.__node; p = p->next)
+				++offset;
+			if (offset > 0) {
+				pos.__list->__split(offset);
+				left = pos.__list;
+			}
+		}
+		list *first, *last;
+		__size += other.__size;
+		__take(other, first, last);
+		node *first_node = first->head->next;
+		__link(left, first, last);
+		__mend(last);
+		if (__mend(left)) first = left;
+		return iterator(this, first, first_node);
+	}
 
 public:
 	class iterator {
 		friend class const_iterator;
 		friend iterator deque::insert(iterator, const T &);
 		friend iterator deque::erase(iterator);
+		friend iterator deque::splice(iterator, deque &&);
 	public:
 		typedef T value;
 		typedef T * pointer;
@@ -0,0 +1,96 @@
+#include "deque.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <cassert>
+#include <deque>
+#include <utility>
+
+typedef sjtu::deque<int> deque_t;
+
+bool equal(deque_t &q, const std::deque<int> &stl) {
+	if (q.size() != stl.size()) return false;
+	size_t i = 0;
+	for (deque_t::iterator it = q.begin(); it != q.end(); ++it, ++i)
+		if (*it != stl[i]) return false;
+	for (i = 0; i < stl.size(); i += 13)
+		if (q[i] != stl[i]) return false;
+	return true;
+}
+
+void print(deque_t &q) {
+	long long checksum = 0;
+	for (deque_t::const_iterator it = q.cbegin(); it != q.cend(); ++it)
+		checksum = (checksum * 131 + *it) % 1000000007;
+	std::cout << q.size() << " " << checksum << std::endl;
+}
+
+int main() {
+	deque_t q[3];
+	std::deque<int> stl[3];
+	for (int time = 0; time < 6; ++time) {
+		for (int i = 0; i < 3000; ++i) {
+			int a = rand() % 3, b = (a + 1 + rand() % 2) % 3;
+			switch (rand() % 8) {
+			case 0:
+			case 1:
+			case 2:
+			case 3:
+				for (int n = rand() % 200; n > 0; --n) {
+					int value = rand() % 100000;
+					q[a].push_back(value);
+					stl[a].push_back(value);
+				}
+				break;
+			case 4:
+				q[a].append(std::move(q[b]));
+				stl[a].insert(stl[a].end(), stl[b].begin(), stl[b].end());
+				stl[b].clear();
+				break;
+			case 5:
+				q[a].prepend(std::move(q[b]));
+				stl[a].insert(stl[a].begin(), stl[b].begin(), stl[b].end());
+				stl[b].clear();
+				break;
+			case 6: {
+				size_t pos = rand() % (stl[a].size() + 1);
+				q[b] = q[a].split_off(pos);
+				stl[b].assign(stl[a].begin() + pos, stl[a].end());
+				stl[a].resize(pos);
+				break;
+			}
+			default: {
+				size_t pos = rand() % (stl[a].size() + 1), n = stl[b].size();
+				deque_t::iterator it = q[a].splice(q[a].begin() + pos, std::move(q[b]));
+				stl[a].insert(stl[a].begin() + pos, stl[b].begin(), stl[b].end());
+				stl[b].clear();
+				if (n > 0 && (*it != stl[a][pos] || it - q[a].begin() != static_cast<int>(pos))) {
+					std::cout << "Wrong Answer" << std::endl;
+					return 0;
+				}
+			}
+			}
+			assert(q[b].size() == stl[b].size());
+		}
+		for (int k = 0; k < 3; ++k) {
+			if (!equal(q[k], stl[k])) {
+				std::cout << "Wrong Answer" << std::endl;
+				return 0;
+			}
+			print(q[k]);
+		}
+	}
+	// bulk operations keep the old element objects
+	deque_t whole;
+	for (int i = 0; i < 100000; ++i) whole.push_back(i);
+	int *address = &whole[70000];
+	deque_t rest = whole.split_off(50000);
+	std::cout << (&rest[20000] == address) << " " << whole.size() << " " << rest.size() << std::endl;
+	whole.append(std::move(rest));
+	std::cout << (&whole[70000] == address) << " " << whole.size() << " " << rest.size() << " " << rest.empty() << std::endl;
+	try {
+		whole.split_off(100001);
+	} catch (...) {
+		std::cout << "exception" << std::endl;
+	}
+	return 0;
+}
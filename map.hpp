@@ -9,6 +9,11 @@
 
 #include <functional>
 #include <cstddef>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include "utility.hpp"
 #include "exceptions.hpp"
 
@@ -27,6 +32,7 @@ public:
 public: // iterator type
 	class const_iterator;
 	class iterator;
+	class node_type;
 private:
 	struct __rbt_node {
 		typedef bool which_t;
@@ -45,20 +51,18 @@ private:
 			delete value;
 		}
 
-		__rbt_node(__rbt_node *other, __rbt_node *father, __rbt_node *prev, __rbt_node *next) :
-			value(new value_type(*other->value)), father(father), prev(prev), next(next),
-			which(other->which), color(other->color) {
+		explicit __rbt_node(const __rbt_node *other) : // copy the value and the color only
+			which(other->which), color(other->color), prev(nullptr), next(nullptr), father(nullptr),
+			value(new value_type(*other->value)) {
 			child[LEFT] = child[RIGHT] = nullptr;
-			prev->next = next->prev = this;
-			if (other->child[LEFT] != nullptr)
-				child[LEFT] = new __rbt_node(other->child[LEFT], this, prev, this);
-			if (other->child[RIGHT] != nullptr)
-				child[RIGHT] = new __rbt_node(other->child[RIGHT], this, this, next);
 		}
-	
+
 		void update_links() {
 			next->prev = this;
 			prev->next = this;
+			update_tree_links();
+		}
+		void update_tree_links() { // rotations keep the in-order threading untouched
 			if (father != nullptr) father->child[which] = this;
 			if (child[LEFT] != nullptr) {
 				child[LEFT]->father = this;
@@ -94,6 +98,8 @@ private:
 	Compare compare;
 	size_t __size;
 
+	static constexpr size_t __copy_grain = 1 << 15; // the least elements per worker in a parallel copy
+
 	static constexpr typename __rbt_node::which_t LEFT = false;
 	static constexpr typename __rbt_node::which_t RIGHT = true;
 	static constexpr typename __rbt_node::color_t RED = __rbt_node::RED;
@@ -138,17 +144,18 @@ private:
 		y->which = x->which;
 		x->father = y;
 		x->which = which;
-		x->update_links();
-		y->update_links();
+		x->update_tree_links();
+		y->update_tree_links();
 	}
 
-	void insert_rebalance(link_type target) {
+	bool insert_rebalance(link_type target) { // return true if the black height grows
 		link_type father = target->father;
 		if (father == nullptr) {
+			bool grown = target->color == RED;
 			target->color = BLACK;
-			return;
+			return grown;
 		}
-		if (father->color == BLACK) return;
+		if (father->color == BLACK) return false;
 		link_type grandfather = father->father;
 		link_type uncle = target->father->brother();
 		if (uncle == nullptr || uncle->color == BLACK) {
@@ -162,23 +169,24 @@ private:
 				rotate(father, target->which ^ 1);
 				rotate(grandfather, target->which ^ 1);
 			}
+			return false;
 		} else {
 			father->color = uncle->color = BLACK;
 			grandfather->color = RED;
-			insert_rebalance(grandfather);
+			return insert_rebalance(grandfather);
 		}
 	}
 
-	void erase_rebalance(link_type target, bool recursive = false) {
-		if (target->color == RED && !recursive) return; // no need to change
+	bool erase_rebalance(link_type target, bool recursive = false) { // return true if the black height shrinks
+		if (target->color == RED && !recursive) return false; // no need to change
 		link_type child = target->child[target->child[LEFT] == nullptr];
 		if (child != nullptr && child->color == RED && !recursive) {
 			child->color = BLACK;
-			return;
+			return false;
 		}
 		if (target == root) { // root is black
 			target->color = BLACK;
-			return;
+			return true;
 		}
 		link_type father = target->father;
 		// assert(target != root);
@@ -191,8 +199,7 @@ private:
 			(cousin[LEFT] == nullptr || cousin[LEFT]->color == BLACK) &&
 			(cousin[RIGHT] == nullptr || cousin[RIGHT]->color == BLACK)) {
 			brother->color = RED;
-			erase_rebalance(father, true);
-			return;
+			return erase_rebalance(father, true);
 		}
 
 		if (brother->color == RED) {
@@ -208,7 +215,7 @@ private:
 			(cousin[RIGHT] == nullptr || cousin[RIGHT]->color == BLACK)) {
 			father->color = BLACK;
 			brother->color = RED;
-			return;
+			return false;
 		}
 
 		if (cousin[!target->which] == nullptr || cousin[!target->which]->color == BLACK) {
@@ -222,29 +229,51 @@ private:
 		swap(father->color, brother->color);
 		cousin[!target->which]->color = BLACK;
 		rotate(father, target->which); // make target up
+		return false;
 	}
 
-	template <typename U> pair<link_type, bool> __insert(const Key &key, const U &value) {
-		if (root == nullptr) {
-			link_type new_node = new __rbt_node(value, head, tail, nullptr, nullptr, nullptr, LEFT);
-			root = new_node;
-			++__size;
-			insert_rebalance(new_node);
-			return {new_node, true};
-		}
+	// return the node holding key, or the father to hang a new node on (nullptr if the tree is empty)
+	pair<link_type, bool> locate(const Key &key, which_type &which) const {
+		which = LEFT;
 		link_type cur = root;
-		which_type which;
+		if (cur == nullptr) return {cur, false};
 		while (true) {
 			which = compare(cur->value->first, key);
-			if (!which && !compare(key, cur->value->first)) return {cur, false};
-			if (cur->child[which] == nullptr) break;
+			if (!which && !compare(key, cur->value->first)) return {cur, true};
+			if (cur->child[which] == nullptr) return {cur, false};
 			cur = cur->child[which];
 		}
-		link_type new_node = new __rbt_node(value, which ? cur : cur->prev, which ? cur->next : cur, cur, nullptr, nullptr, which);
+	}
+	template <typename U> pair<link_type, bool> __insert(const Key &key, const U &value) {
+		which_type which;
+		auto position = locate(key, which);
+		link_type cur = position.first;
+		if (position.second) return {cur, false};
+		link_type new_node = cur == nullptr ?
+			new __rbt_node(value, head, tail, nullptr, nullptr, nullptr, LEFT) :
+			new __rbt_node(value, which ? cur : cur->prev, which ? cur->next : cur, cur, nullptr, nullptr, which);
+		if (cur == nullptr) root = new_node;
 		++__size;
 		insert_rebalance(new_node);
 		return {new_node, true};
 	}
+	pair<link_type, bool> __insert_node(link_type target) { // relink an extracted node
+		which_type which;
+		auto position = locate(target->value->first, which);
+		link_type cur = position.first;
+		if (position.second) return {cur, false};
+		target->prev = cur == nullptr ? head : which ? cur : cur->prev;
+		target->next = cur == nullptr ? tail : which ? cur->next : cur;
+		target->father = cur;
+		target->which = which;
+		target->color = RED;
+		target->child[LEFT] = target->child[RIGHT] = nullptr;
+		target->update_links();
+		if (cur == nullptr) root = target;
+		++__size;
+		insert_rebalance(target);
+		return {target, true};
+	}
 
 	pair<link_type, bool> __insert(const value_type &value) {
 		return __insert(value.first, value);
@@ -252,15 +281,8 @@ private:
 	link_type __insert(const Key &key) {
 		return __insert(key, key).first;
 	}
-	void erase(link_type target) {
-		--__size;
-		if (target->child[LEFT] != nullptr && target->child[RIGHT] != nullptr) {
-			swap_node(target, target->next);
-		}
-		// debug("erase rebalance start!!!");
-		erase_rebalance(target);
-		// debug("erase rebalance end!!!");
-		link_node(target->prev, target->next);
+	bool detach(link_type target) { // target has at most one child, the threading is left as it is
+		bool shrunk = erase_rebalance(target);
 		link_type child = target->child[target->child[LEFT] == nullptr];
 		if (target == root)
 			root = child;
@@ -270,17 +292,410 @@ private:
 			child->father = target->father;
 			child->which = target->which;
 		}
+		target->father = target->child[LEFT] = target->child[RIGHT] = nullptr;
+		return shrunk;
+	}
+	void unlink(link_type target) {
+		if (target->child[LEFT] != nullptr && target->child[RIGHT] != nullptr) {
+			swap_node(target, target->next);
+		}
+		// debug("erase rebalance start!!!");
+		detach(target);
+		// debug("erase rebalance end!!!");
+		link_node(target->prev, target->next);
+	}
+	void erase(link_type target) {
+		--__size;
+		unlink(target);
 		delete target;
 	}
+
+	/**
+	 * Join-based bulk operations.
+	 * The helpers below work on detached subtrees and only maintain tree links,
+	 * `root` is used as a scratch register by rotate() and the rebalance routines.
+	 * The black height of an empty tree is 0, and it is passed along to make join O(|lh - rh| + 1).
+	 */
+	static bool is_black(link_type x) {
+		return x != nullptr && x->color == BLACK;
+	}
+	static size_t black_height(link_type x) {
+		size_t height = 0;
+		for (; x != nullptr; x = x->child[LEFT])
+			height += is_black(x);
+		return height;
+	}
+	static link_type leftmost(link_type x) {
+		while (x->child[LEFT] != nullptr) x = x->child[LEFT];
+		return x;
+	}
+	static link_type rightmost(link_type x) {
+		while (x->child[RIGHT] != nullptr) x = x->child[RIGHT];
+		return x;
+	}
+	static void make_root(link_type &x, size_t &height) {
+		if (x == nullptr) return;
+		x->father = nullptr;
+		if (x->color == RED) {
+			x->color = BLACK;
+			++height;
+		}
+	}
+	// keys in left < mid < keys in right
+	link_type join(link_type left, size_t left_height, link_type mid, link_type right, size_t right_height, size_t &height) {
+		make_root(left, left_height);
+		make_root(right, right_height);
+		mid->child[LEFT] = mid->child[RIGHT] = nullptr;
+		if (left_height == right_height) {
+			mid->father = nullptr;
+			mid->color = BLACK;
+			mid->child[LEFT] = left;
+			mid->child[RIGHT] = right;
+			mid->update_tree_links();
+			height = left_height + 1;
+			return root = mid;
+		}
+		which_type which = left_height < right_height; // the side to walk down
+		link_type cur = which ? right : left;
+		size_t cur_height = which ? right_height : left_height;
+		size_t target_height = which ? left_height : right_height;
+		link_type father = nullptr;
+		while (cur != nullptr && (cur->color == RED || cur_height != target_height)) {
+			cur_height -= is_black(cur);
+			father = cur;
+			cur = cur->child[which ^ 1];
+		}
+		root = which ? right : left;
+		mid->color = RED;
+		mid->father = father;
+		mid->which = which ^ 1;
+		mid->child[which] = cur;
+		mid->child[which ^ 1] = which ? left : right;
+		mid->update_tree_links();
+		height = (which ? right_height : left_height) + insert_rebalance(mid);
+		return root;
+	}
+	link_type join(link_type left, size_t left_height, link_type right, size_t right_height, size_t &height) {
+		if (left == nullptr) {
+			height = right_height;
+			return right;
+		}
+		if (right == nullptr) {
+			height = left_height;
+			return left;
+		}
+		make_root(right, right_height);
+		root = right;
+		link_type mid = leftmost(right);
+		right_height -= detach(mid);
+		return join(left, left_height, mid, root, right_height, height);
+	}
+	// keys < key go to left, keys > key go to right, return the node equal to key (detached) or nullptr
+	link_type split(link_type x, size_t x_height, const Key &key,
+		link_type &left, size_t &left_height, link_type &right, size_t &right_height) {
+		if (x == nullptr) {
+			left = right = nullptr;
+			left_height = right_height = 0;
+			return nullptr;
+		}
+		link_type x_left = x->child[LEFT], x_right = x->child[RIGHT];
+		size_t child_height = x_height - is_black(x);
+		if (compare(key, x->value->first)) {
+			link_type found = split(x_left, child_height, key, left, left_height, right, right_height);
+			right = join(right, right_height, x, x_right, child_height, right_height);
+			return found;
+		}
+		if (compare(x->value->first, key)) {
+			link_type found = split(x_right, child_height, key, left, left_height, right, right_height);
+			left = join(x_left, child_height, x, left, left_height, left_height);
+			return found;
+		}
+		left = x_left;
+		right = x_right;
+		left_height = right_height = child_height;
+		if (left != nullptr) left->father = nullptr;
+		if (right != nullptr) right->father = nullptr;
+		x->father = x->child[LEFT] = x->child[RIGHT] = nullptr;
+		return x;
+	}
+	// thread the in-order list across the seam of a join
+	static void link_seam(link_type left, link_type mid, link_type right) {
+		if (mid == nullptr) {
+			if (left == nullptr || right == nullptr) return;
+			link_type last = rightmost(left), first = leftmost(right);
+			last->next = first;
+			first->prev = last;
+			return;
+		}
+		if (left != nullptr) {
+			link_type last = rightmost(left);
+			last->next = mid;
+			mid->prev = last;
+		}
+		if (right != nullptr) {
+			link_type first = leftmost(right);
+			first->prev = mid;
+			mid->next = first;
+		}
+	}
+	void destroy(link_type x) {
+		if (x == nullptr) return;
+		destroy(x->child[LEFT]);
+		destroy(x->child[RIGHT]);
+		--__size;
+		delete x;
+	}
+	// nodes of b are moved into a, the nodes whose keys are already in a are chained after rest
+	link_type unite(link_type a, size_t a_height, link_type b, size_t b_height, size_t &height, link_type &rest) {
+		if (b == nullptr) {
+			height = a_height;
+			return a;
+		}
+		if (a == nullptr) {
+			height = b_height;
+			return b;
+		}
+		link_type b_left = b->child[LEFT], b_right = b->child[RIGHT];
+		size_t b_child_height = b_height - is_black(b);
+		link_type a_left, a_right;
+		size_t a_left_height, a_right_height, left_height, right_height;
+		link_type mid = split(a, a_height, b->value->first, a_left, a_left_height, a_right, a_right_height);
+		link_type left = unite(a_left, a_left_height, b_left, b_child_height, left_height, rest);
+		if (mid == nullptr) {
+			mid = b;
+		} else {
+			rest->next = b;
+			b->prev = rest;
+			rest = b;
+		}
+		link_type right = unite(a_right, a_right_height, b_right, b_child_height, right_height, rest);
+		link_seam(left, mid, right);
+		return join(left, left_height, mid, right, right_height, height);
+	}
+	link_type intersect(link_type a, size_t a_height, const __rbt_node *b, size_t &height) {
+		if (a == nullptr || b == nullptr) {
+			destroy(a);
+			height = 0;
+			return nullptr;
+		}
+		link_type a_left, a_right;
+		size_t a_left_height, a_right_height, left_height, right_height;
+		link_type mid = split(a, a_height, b->value->first, a_left, a_left_height, a_right, a_right_height);
+		link_type left = intersect(a_left, a_left_height, b->child[LEFT], left_height);
+		link_type right = intersect(a_right, a_right_height, b->child[RIGHT], right_height);
+		link_seam(left, mid, right);
+		if (mid == nullptr) return join(left, left_height, right, right_height, height);
+		return join(left, left_height, mid, right, right_height, height);
+	}
+	link_type subtract(link_type a, size_t a_height, const __rbt_node *b, size_t &height) {
+		if (a == nullptr || b == nullptr) {
+			height = a_height;
+			return a;
+		}
+		link_type a_left, a_right;
+		size_t a_left_height, a_right_height, left_height, right_height;
+		link_type mid = split(a, a_height, b->value->first, a_left, a_left_height, a_right, a_right_height);
+		link_type left = subtract(a_left, a_left_height, b->child[LEFT], left_height);
+		link_type right = subtract(a_right, a_right_height, b->child[RIGHT], right_height);
+		if (mid != nullptr) {
+			--__size;
+			delete mid;
+		}
+		link_seam(left, nullptr, right);
+		return join(left, left_height, right, right_height, height);
+	}
+	// build a balanced tree from the n nodes threaded from first, the deepest level is red
+	static link_type build(link_type &first, size_t n, size_t depth, size_t red_depth) {
+		if (n == 0) return nullptr;
+		link_type left = build(first, (n - 1) >> 1, depth + 1, red_depth);
+		link_type x = first;
+		first = first->next;
+		x->father = nullptr;
+		x->color = depth != 0 && depth == red_depth ? RED : BLACK;
+		x->child[LEFT] = left;
+		x->child[RIGHT] = build(first, n - 1 - ((n - 1) >> 1), depth + 1, red_depth);
+		x->update_tree_links();
+		return x;
+	}
+	void rebuild() { // rebuild the tree from the threading
+		size_t red_depth = 0;
+		while ((static_cast<size_t>(2) << red_depth) <= __size) ++red_depth;
+		link_type first = head->next;
+		root = build(first, __size, 0, red_depth);
+	}
+	void reset_root(link_type new_root, size_t height) { // adopt the result of a bulk operation
+		make_root(new_root, height);
+		root = new_root;
+		if (root == nullptr) {
+			link_node(head, tail);
+			return;
+		}
+		link_node(head, leftmost(root));
+		link_node(rightmost(root), tail);
+	}
+	link_type lower_bound_node(const Key &key) const {
+		link_type cur = root, result = tail;
+		while (cur != nullptr) {
+			if (compare(cur->value->first, key)) {
+				cur = cur->child[RIGHT];
+			} else {
+				result = cur;
+				cur = cur->child[LEFT];
+			}
+		}
+		return result;
+	}
+
+	static void discard(link_type x) { // free a detached subtree, the size is left alone
+		if (x == nullptr) return;
+		discard(x->child[LEFT]);
+		discard(x->child[RIGHT]);
+		delete x;
+	}
+	/**
+	 * Deep copy without recursion.
+	 * clone() walks the source in order with an explicit stack, copying the shape of the subtree
+	 *   and threading the copied nodes in the same pass, and reports both ends of the copy.
+	 * the height of a red-black tree is below 2 log(n + 1), so 128 slots are enough.
+	 * if a value fails to copy, the nodes copied so far are freed before the exception leaves.
+	 */
+	static link_type clone(const __rbt_node *source, link_type &first, link_type &last) {
+		const __rbt_node *source_stack[128];
+		link_type target_stack[128];
+		size_t top = 0;
+		link_type result = nullptr, father = nullptr;
+		which_type which = LEFT;
+		first = last = nullptr;
+		try {
+			while (true) {
+				for (; source != nullptr; source = source->child[LEFT]) {
+					link_type copied = new __rbt_node(source);
+					copied->father = father;
+					if (father == nullptr)
+						result = copied;
+					else
+						father->child[which] = copied;
+					source_stack[top] = source;
+					target_stack[top++] = copied;
+					father = copied;
+					which = LEFT;
+				}
+				if (top == 0) break;
+				--top;
+				link_type cur = target_stack[top];
+				if (last == nullptr) {
+					first = cur;
+				} else {
+					last->next = cur;
+					cur->prev = last;
+				}
+				last = cur;
+				source = source_stack[top]->child[RIGHT];
+				father = cur;
+				which = RIGHT;
+			}
+		} catch (...) {
+			discard(result);
+			first = last = nullptr;
+			throw;
+		}
+		return result;
+	}
+	struct clone_task {
+		const __rbt_node *source; // nullptr if the piece is a node copied in the top levels
+		link_type father, result, first, last;
+		which_type which;
+	};
+	// copy the top levels serially, the subtrees below depth are left as tasks, pieces are kept in order
+	static link_type copy_top(const __rbt_node *source, size_t depth, link_type father, std::vector<clone_task> &pieces) {
+		if (source == nullptr) return nullptr;
+		if (depth == 0) {
+			pieces.push_back({source, father, nullptr, nullptr, nullptr, source->which});
+			return nullptr;
+		}
+		link_type x = new __rbt_node(source);
+		x->father = father;
+		try {
+			x->child[LEFT] = copy_top(source->child[LEFT], depth - 1, x, pieces);
+			pieces.push_back({nullptr, father, x, x, x, source->which});
+			x->child[RIGHT] = copy_top(source->child[RIGHT], depth - 1, x, pieces);
+		} catch (...) {
+			discard(x);
+			throw;
+		}
+		return x;
+	}
+	// on an exception nothing is kept, the map stays empty and the error reaches the caller
+	void copy_from(const map &other, size_t threads) {
+		if (other.__size == 0) return;
+		link_type first, last;
+		if (threads <= 1 || other.__size < __copy_grain * 2) {
+			root = clone(other.root, first, last);
+		} else {
+			if (threads > other.__size / __copy_grain) threads = other.__size / __copy_grain;
+			size_t depth = 2; // about four pieces for each worker
+			while ((static_cast<size_t>(1) << depth) < threads * 4) ++depth;
+			std::vector<clone_task> pieces;
+			root = copy_top(other.root, depth, nullptr, pieces);
+			std::atomic<size_t> next_piece(0);
+			std::vector<std::exception_ptr> errors(threads);
+			auto worker = [&pieces, &next_piece, &errors](size_t id) {
+				try {
+					for (size_t i = next_piece++; i < pieces.size(); i = next_piece++) {
+						clone_task &piece = pieces[i];
+						if (piece.source == nullptr) continue;
+						piece.result = clone(piece.source, piece.first, piece.last);
+					}
+				} catch (...) {
+					errors[id] = std::current_exception();
+				}
+			};
+			std::vector<std::thread> workers;
+			workers.reserve(threads); // a bad_alloc here must come before any thread is running
+			try {
+				for (size_t i = 1; i < threads; ++i) workers.emplace_back(worker, i);
+			} catch (const std::system_error &) {
+				// out of threads, the pieces left over are taken here
+			}
+			worker(0);
+			for (auto &t : workers) t.join();
+			for (std::exception_ptr &error : errors) {
+				if (!error) continue;
+				for (clone_task &piece : pieces) {
+					if (piece.source != nullptr) discard(piece.result);
+				}
+				discard(root);
+				root = nullptr;
+				std::rethrow_exception(error);
+			}
+			for (size_t i = 0; i < pieces.size(); ++i) { // stitch the pieces together
+				if (pieces[i].source != nullptr) {
+					pieces[i].result->father = pieces[i].father;
+					pieces[i].result->update_tree_links();
+				}
+				if (i > 0) link_node(pieces[i - 1].last, pieces[i].first);
+			}
+			first = pieces.front().first;
+			last = pieces.back().last;
+		}
+		__size = other.__size;
+		link_node(head, first);
+		link_node(last, tail);
+	}
 public:
 	map() : head(new __rbt_node), tail(new __rbt_node), root(nullptr), compare(), __size(0) {
 		head->next = tail;
 		tail->prev = head;
 	}
 	map(const map &other) : map() {
-		if (other.__size == 0) return;
-		__size = other.__size;
-		root = new __rbt_node(other.root, nullptr, head, tail);
+		copy_from(other, 1);
+	}
+	/**
+	 * copy other with up to threads workers, each cloning disjoint subtrees.
+	 * small maps are copied serially.
+	 */
+	map(const map &other, size_t threads) : map() {
+		copy_from(other, threads);
 	}
 	/**
 	 * TODO assignment operator
@@ -288,9 +703,7 @@ public:
 	map &operator=(const map &other) {
 		if (this == &other) return *this;
 		clear();
-		__size = other.__size;
-		if (__size == 0) return *this;
-		root = new __rbt_node(other.root, nullptr, head, tail);
+		copy_from(other, 1);
 		return *this;
 	}
 	~map() {
@@ -366,6 +779,36 @@ public:
 		auto result = __insert(value);
 		return {iterator(this, result.first), result.second};
 	}
+	/**
+	 * insert an extracted node without any allocation.
+	 * if the key already exists, the node stays in the handle.
+	 */
+	pair<iterator, bool> insert(node_type &&handle) {
+		if (handle.empty()) return {end(), false};
+		auto result = __insert_node(handle.node);
+		if (result.second) handle.node = nullptr;
+		return {iterator(this, result.first), result.second};
+	}
+	/**
+	 * unlink the element at pos without freeing it, and hand it over in a node handle.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	node_type extract(iterator pos) {
+		if (pos.__map != this || pos == end()) throw invalid_iterator();
+		--__size;
+		unlink(pos.node);
+		pos.node->prev = pos.node->next = nullptr;
+		return node_type(pos.node);
+	}
+	/**
+	 * return an empty handle if there is no such key.
+	 */
+	node_type extract(const Key &key) {
+		iterator pos = find(key);
+		if (pos == end()) return node_type();
+		return extract(pos);
+	}
 	/**
 	 * erase the element at pos.
 	 *
@@ -409,10 +852,161 @@ public:
 		}
 		return cend();
 	}
+	/**
+	 * move all the elements of other to the end of this map in O(log n + log m) where m is the size of other,
+	 *   the sizes are added without a recount.
+	 * every key in other must be greater than the keys in this map, or runtime_error is thrown.
+	 */
+	void join(map &other) {
+		if (this == &other || other.__size == 0) return;
+		if (__size != 0 && !compare(tail->prev->value->first, other.head->next->value->first)) throw runtime_error();
+		link_type first = other.head->next, last = other.tail->prev;
+		size_t height;
+		link_type new_root = join(root, black_height(root), other.root, black_height(other.root), height);
+		link_node(tail->prev, first);
+		link_node(last, tail);
+		reset_root(new_root, height);
+		__size += other.__size;
+		other.__size = 0;
+		other.reset_root(nullptr, 0);
+	}
+	/**
+	 * split the map at key, the elements not less than key are moved into the returned map.
+	 * the trees are cut in O(log n) but nodes keep no subtree sizes, so the sizes are recounted
+	 *   by walking the list from the cut until the smaller side ends: O(log n + min(k, n - k))
+	 *   in total, where k is the number of elements moved.
+	 */
+	map split(const Key &key) {
+		map other;
+		link_type first = lower_bound_node(key);
+		if (first == tail) return other;
+		size_t moved = 0;
+		for (link_type forward = first, backward = first->prev; ; forward = forward->next, backward = backward->prev) {
+			if (forward == tail) break;
+			if (backward == head) {
+				moved = __size - moved;
+				break;
+			}
+			++moved;
+		}
+		link_type last = tail->prev, left, right;
+		size_t left_height, right_height;
+		link_type mid = split(root, black_height(root), key, left, left_height, right, right_height);
+		if (mid != nullptr) right = join(nullptr, 0, mid, right, right_height, right_height);
+		link_node(first->prev, tail);
+		link_node(other.head, first);
+		link_node(last, other.tail);
+		reset_root(left, left_height);
+		other.reset_root(right, right_height);
+		__size -= moved;
+		other.__size = moved;
+		return other;
+	}
+	/**
+	 * move the elements of other whose keys are not in this map into this map without copying,
+	 *   the rest stay in other. O(m log(n / m + 1)) where m is the size of other.
+	 */
+	void merge(map &other) {
+		if (this == &other || other.__size == 0) return;
+		link_type rest = other.head;
+		size_t height;
+		link_type new_root = unite(root, black_height(root), other.root, black_height(other.root), height, rest);
+		link_node(rest, other.tail);
+		reset_root(new_root, height);
+		size_t rest_size = 0;
+		for (link_type cur = other.head->next; cur != other.tail; cur = cur->next) ++rest_size;
+		__size += other.__size - rest_size;
+		other.__size = rest_size;
+		other.rebuild();
+	}
+	/**
+	 * keep the union of this and other in this map, other is left empty.
+	 */
+	void set_union(map &other) {
+		merge(other);
+		if (this != &other) other.clear();
+	}
+	/**
+	 * keep only the elements whose keys are in other.
+	 */
+	void set_intersection(const map &other) {
+		if (this == &other) return;
+		size_t height;
+		link_type new_root = intersect(root, black_height(root), other.root, height);
+		reset_root(new_root, height);
+	}
+	/**
+	 * erase the elements whose keys are in other.
+	 */
+	void set_difference(const map &other) {
+		if (this == &other) {
+			clear();
+			return;
+		}
+		size_t height;
+		link_type new_root = subtract(root, black_height(root), other.root, height);
+		reset_root(new_root, height);
+	}
 public:
+	/**
+	 * owns a node unlinked from a map, move-only.
+	 * the node is freed with the handle unless it is inserted into a map again.
+	 */
+	class node_type {
+		friend class map;
+	private:
+		__rbt_node *node;
+		explicit node_type(__rbt_node *node) : node(node) {}
+	public:
+		node_type() : node(nullptr) {}
+		node_type(const node_type &other) = delete;
+		node_type(node_type &&other) noexcept : node(other.node) {
+			other.node = nullptr;
+		}
+		node_type &operator=(const node_type &other) = delete;
+		node_type &operator=(node_type &&other) noexcept {
+			if (this == &other) return *this;
+			delete node;
+			node = other.node;
+			other.node = nullptr;
+			return *this;
+		}
+		~node_type() {
+			delete node;
+		}
+
+		bool empty() const {
+			return node == nullptr;
+		}
+		explicit operator bool() const {
+			return node != nullptr;
+		}
+		/**
+		 * throw invalid_iterator if the handle is empty.
+		 */
+		const Key &key() const {
+			if (node == nullptr) throw invalid_iterator();
+			return node->value->first;
+		}
+		/**
+		 * give the node a new key while it is out of any map.
+		 * the stored key is const, so the value is rebuilt around a copy of the mapped value.
+		 * throw invalid_iterator if the handle is empty.
+		 */
+		void set_key(const Key &key) {
+			if (node == nullptr) throw invalid_iterator();
+			value_type *value = new value_type(key, node->value->second);
+			delete node->value;
+			node->value = value;
+		}
+		T &mapped() const {
+			if (node == nullptr) throw invalid_iterator();
+			return node->value->second;
+		}
+	};
 	class iterator {
 		friend class const_iterator;
-		friend void map::erase(iterator);
+		friend class map;
 	public:
 		typedef pair<const Key, T> value_type;
 		typedef value_type * pointer;
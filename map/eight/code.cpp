@@ -0,0 +1,113 @@
+#include "map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <cassert>
+#include <string>
+
+typedef sjtu::map<int, std::string> map_t;
+
+std::string to_string(int x) {
+	std::string result = "";
+	if (x == 0) result = "0";
+	for (; x; x /= 10) result = static_cast<char>('0' + x % 10) + result;
+	return result;
+}
+
+void print(const map_t &map) {
+	long long checksum = 0;
+	int counter = 0;
+	for (map_t::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		checksum = checksum * 131 % 1000000007 + it->first;
+		if ((++counter) % 97 == 0) std::cout << it->second << " ";
+	}
+	std::cout << map.size() << " " << checksum << std::endl;
+}
+
+void fill(map_t &map, int n, int range) {
+	for (int i = 0; i < n; ++i) {
+		int key = rand() % range;
+		map[key] = to_string(key);
+	}
+}
+
+void test_split_join() {
+	std::cout << "split & join" << std::endl;
+	map_t map;
+	fill(map, 20000, 100000);
+	print(map);
+	for (int time = 0; time < 10; ++time) {
+		int key = rand() % 110000 - 5000;
+		map_t right = map.split(key);
+		if (!map.empty()) assert((--map.end())->first < key);
+		if (!right.empty()) assert(right.begin()->first >= key);
+		print(map);
+		print(right);
+		map.join(right);
+		assert(right.empty() && right.begin() == right.end());
+		print(map);
+	}
+	map_t left;
+	left[-1] = "-1";
+	try {
+		map.join(left);
+		std::cout << "no exception" << std::endl;
+	} catch (...) {
+		std::cout << "exception" << std::endl;
+	}
+	left.join(map);
+	print(left);
+	print(map);
+}
+
+void test_merge() {
+	std::cout << "merge" << std::endl;
+	for (int time = 0; time < 10; ++time) {
+		map_t a, b;
+		fill(a, rand() % 10000, 30000);
+		fill(b, rand() % 1000, 30000);
+		size_t total = a.size() + b.size();
+		a.merge(b);
+		assert(a.size() + b.size() == total);
+		for (map_t::iterator it = b.begin(); it != b.end(); ++it) assert(a.count(it->first) == 1);
+		print(a);
+		print(b);
+		b[-time] = "x";
+		a.set_union(b);
+		assert(b.empty());
+		print(a);
+	}
+}
+
+void test_set_operations() {
+	std::cout << "intersection & difference" << std::endl;
+	for (int time = 0; time < 10; ++time) {
+		map_t a, b;
+		fill(a, rand() % 10000, 20000);
+		fill(b, rand() % 10000, 20000);
+		map_t c(a), d(a);
+		c.set_intersection(b);
+		d.set_difference(b);
+		assert(c.size() + d.size() == a.size());
+		for (map_t::iterator it = c.begin(); it != c.end(); ++it) assert(b.count(it->first) == 1);
+		for (map_t::iterator it = d.begin(); it != d.end(); ++it) assert(b.count(it->first) == 0);
+		print(c);
+		print(d);
+		d.merge(c);
+		assert(d.size() == a.size());
+		print(d);
+		for (int i = 0; i < 1000; ++i) {
+			int key = rand() % 20000;
+			map_t::iterator it = d.find(key);
+			if (it != d.end()) d.erase(it);
+			else d[key] = to_string(key);
+		}
+		print(d);
+	}
+}
+
+int main() {
+	test_split_join();
+	test_merge();
+	test_set_operations();
+	return 0;
+}
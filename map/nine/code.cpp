@@ -0,0 +1,101 @@
+#include "map.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+class Integer {
+public:
+	static int counter;
+	int val;
+
+	Integer(int val) : val(val) {
+		counter++;
+	}
+
+	Integer(const Integer &rhs) {
+		val = rhs.val;
+		counter++;
+	}
+
+	Integer& operator = (const Integer &rhs) {
+		val = rhs.val;
+		return *this;
+	}
+
+	~Integer() {
+		counter--;
+	}
+};
+
+int Integer::counter = 0;
+
+class Compare {
+public:
+	bool operator () (const Integer &lhs, const Integer &rhs) const {
+		return lhs.val < rhs.val;
+	}
+};
+
+typedef sjtu::map<Integer, std::string, Compare> map_t;
+
+void print(const map_t &map) {
+	int counter = 0;
+	for (map_t::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		if ((++counter) % 53 == 0) std::cout << it->first.val << ":" << it->second << " ";
+	}
+	std::cout << map.size() << std::endl;
+}
+
+void tester() {
+	map_t a, b;
+	for (int i = 0; i < 10000; ++i) {
+		a.insert(sjtu::pair<Integer, std::string>(Integer(i * 7 % 10007), std::to_string(i)));
+	}
+	int counter = Integer::counter;
+	// move entries between maps, nothing is copied
+	for (int i = 0; i < 10000; i += 3) {
+		map_t::node_type handle = a.extract(Integer(i));
+		if (handle.empty()) continue;
+		auto result = b.insert(std::move(handle));
+		assert(result.second && handle.empty());
+		assert(result.first->first.val == i && a.find(Integer(i)) == a.end());
+	}
+	assert(Integer::counter == counter);
+	print(a);
+	print(b);
+	// change keys
+	for (int i = 0; i < 10000; i += 5) {
+		map_t::iterator it = b.find(Integer(i));
+		if (it == b.end()) continue;
+		map_t::node_type handle = b.extract(it);
+		handle.set_key(Integer(-i));
+		handle.mapped() += "!";
+		assert(b.insert(std::move(handle)).second);
+	}
+	assert(Integer::counter == counter);
+	print(b);
+	// failed insertion keeps the node in the handle
+	map_t::node_type handle = b.extract(b.begin());
+	int key = handle.key().val;
+	b[Integer(key)] = "occupied";
+	auto result = b.insert(std::move(handle));
+	assert(!result.second && !handle.empty());
+	std::cout << result.first->second << " " << handle.mapped() << std::endl;
+	map_t::node_type other;
+	other = std::move(handle);
+	assert(handle.empty() && other);
+	assert(a.extract(Integer(-1)).empty());
+	try {
+		a.extract(a.end());
+	} catch (...) {
+		std::cout << "exception" << std::endl;
+	}
+	print(a);
+	print(b);
+}
+
+int main() {
+	tester();
+	std::cout << Integer::counter << std::endl;
+	return 0;
+}
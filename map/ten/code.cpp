@@ -0,0 +1,96 @@
+#include "map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+// the copy after limit copies throws, counter tracks the live values
+class Bomb {
+public:
+	static std::atomic<int> counter, copies;
+	static int limit;
+	int val;
+
+	Bomb(int val) : val(val) {
+		counter++;
+	}
+
+	Bomb(const Bomb &rhs) {
+		if (limit >= 0 && copies++ >= limit) throw std::runtime_error("copy failed");
+		val = rhs.val;
+		counter++;
+	}
+
+	Bomb& operator = (const Bomb &rhs) {
+		val = rhs.val;
+		return *this;
+	}
+
+	~Bomb() {
+		counter--;
+	}
+};
+
+std::atomic<int> Bomb::counter(0), Bomb::copies(0);
+int Bomb::limit = -1;
+
+typedef sjtu::map<int, std::string> map_t;
+typedef sjtu::map<int, Bomb> bomb_t;
+
+// the copy walks the same way as the source in both directions and stays usable
+bool same(const map_t &a, map_t &b) {
+	if (a.size() != b.size()) return false;
+	map_t::const_iterator it = a.cbegin();
+	for (map_t::const_iterator jt = b.cbegin(); jt != b.cend(); ++it, ++jt) {
+		if (it == a.cend() || it->first != jt->first || it->second != jt->second) return false;
+	}
+	map_t::const_iterator jt = b.cend();
+	for (it = a.cend(); it != a.cbegin();) {
+		--it, --jt;
+		if (it->first != jt->first) return false;
+	}
+	for (int i = 0; i < 1000; ++i) {
+		int key = rand() % 1000000;
+		if (b.count(key) != a.count(key)) return false;
+		if (i % 2) b.erase(b.find(b.cbegin()->first));
+		else b[-key - 1] = "new";
+	}
+	return b.size() == a.size();
+}
+
+int main() {
+	map_t a;
+	for (int i = 0; i < 300000; ++i) a[rand() % 1000000] = std::to_string(i);
+	std::cout << a.size() << std::endl;
+	for (size_t threads : {1, 2, 3, 4, 7, 64}) {
+		map_t copy(a, threads);
+		std::cout << threads << " " << same(a, copy) << std::endl;
+	}
+	// a map just large enough for two workers
+	map_t small;
+	for (int i = 0; i < (1 << 16); ++i) small[i] = "";
+	map_t pair(small, 8);
+	std::cout << same(small, pair) << std::endl;
+
+	// a copy that throws, at the top levels or inside a worker, leaves nothing behind
+	bomb_t b;
+	for (int i = 0; i < 200000; ++i) b.insert(sjtu::pair<int, Bomb>(i, Bomb(i)));
+	int live = Bomb::counter;
+	for (int limit : {0, 5, 30000, 150000, 199999}) {
+		for (size_t threads : {1, 4}) {
+			Bomb::limit = limit;
+			Bomb::copies = 0;
+			try {
+				bomb_t copy(b, threads);
+				std::cout << "copied" << std::endl;
+			} catch (const std::runtime_error &e) {
+				std::cout << limit << " " << threads << " " << e.what() << " " << (Bomb::counter == live) << std::endl;
+			}
+		}
+	}
+	Bomb::limit = -1;
+	bomb_t copy(b, 4);
+	std::cout << copy.size() << " " << (Bomb::counter == 2 * live) << " " << copy.at(123456).val << std::endl;
+	return 0;
+}
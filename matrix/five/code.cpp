@@ -0,0 +1,130 @@
+#include "class-matrix-io.hpp"
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Diamond;
+
+template<typename _Td>
+Matrix<_Td> random_matrix(size_t rows, size_t cols) {
+	Matrix<_Td> a(rows, cols);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j)
+			a[i][j] = static_cast<_Td>(rand() % 1000) / static_cast<_Td>(4);
+	return a;
+}
+
+template<typename _Td>
+bool same(const MatrixView<const _Td> &a, const MatrixView<const _Td> &b) {
+	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) return false;
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < a.ColSize(); ++j)
+			if (a[i][j] != b[i][j]) return false;
+	return true;
+}
+
+template<typename _Td>
+void test(const char *name) {
+	size_t shapes[][2] = {{0, 0}, {0, 5}, {3, 0}, {1, 1}, {7, 3}, {16, 16}, {33, 65}};
+	size_t wrong = 0;
+	const std::string path = "matrix_io_test.bin";
+	for (auto &shape : shapes) {
+		Matrix<_Td> a = random_matrix<_Td>(shape[0], shape[1]);
+		std::stringstream stream;
+		Save(a, stream);
+		wrong += !same<_Td>(Load<_Td>(stream).View(), a.View());
+		// a block starts inside its rows, only its own columns may be read
+		if (shape[0] > 2 && shape[1] > 2) {
+			MatrixView<const _Td> block = a.View().Block(1, 1, shape[0] - 2, shape[1] - 2);
+			std::stringstream blockStream;
+			Save(block, blockStream);
+			wrong += !same<_Td>(Load<_Td>(blockStream).View(), block);
+		}
+		Save(a, path);
+		wrong += !same<_Td>(Load<_Td>(path).View(), a.View());
+#ifdef DIAMOND_MATRIX_MMAP
+		MappedMatrix<_Td> mapped(path);
+		mapped.Advise(MADV_SEQUENTIAL);
+		wrong += !same<_Td>(mapped.View(), a.View());
+		MappedMatrix<_Td> moved(std::move(mapped));
+		wrong += !same<_Td>(moved.View(), a.View()) || mapped.RowSize() != 0;
+#endif
+	}
+	std::remove(path.c_str());
+	std::cout << name << " " << wrong << std::endl;
+}
+
+// a view starting at column 3 of a buffer that ends right after its last element;
+// the view's stride matches the file's, but the view still has to be written row by row
+template<typename _Td>
+void test_offset_view(const char *name) {
+	const size_t rows = 4, cols = 64 / sizeof(_Td) - 6, stride = 64 / sizeof(_Td);
+	std::vector<_Td> buffer(3 + (rows - 1) * stride + cols);
+	for (size_t k = 0; k < buffer.size(); ++k) buffer[k] = static_cast<_Td>(k % 100);
+	MatrixView<const _Td> view(buffer.data() + 3, rows, cols, stride);
+	std::stringstream stream;
+	Save(view, stream);
+	std::string data = stream.str();
+	bool zeroPadding = data.size() == sizeof(MatrixFileHeader) + rows * stride * sizeof(_Td);
+	for (size_t i = 0; i < rows && zeroPadding; ++i) {
+		const char *padding = data.data() + sizeof(MatrixFileHeader) + (i * stride + cols) * sizeof(_Td);
+		for (size_t k = 0; k < (stride - cols) * sizeof(_Td); ++k) zeroPadding = zeroPadding && padding[k] == 0;
+	}
+	std::cout << name << " " << same<_Td>(Load<_Td>(stream).View(), view) << " " << zeroPadding << std::endl;
+}
+
+// load a damaged copy of a saved 4 x 5 matrix of doubles
+std::string load_damaged(size_t offset, const std::string &bytes, size_t keep) {
+	std::stringstream stream;
+	Save(random_matrix<double>(4, 5), stream);
+	std::string data = stream.str();
+	data.replace(offset, bytes.size(), bytes);
+	std::stringstream damaged(data.substr(0, keep));
+	try {
+		Load<double>(damaged);
+		return "no throw";
+	} catch (std::invalid_argument &e) {
+		return e.what();
+	}
+}
+
+int main() {
+	test<double>("double");
+	test<float>("float");
+	test<int>("int");
+	test<short>("short");
+	test<unsigned char>("unsigned char");
+	test_offset_view<double>("offset double");
+	test_offset_view<int>("offset int");
+
+	std::cout << load_damaged(0, "X", 1000) << std::endl;
+	std::cout << load_damaged(0, "", 10) << std::endl;
+	std::cout << load_damaged(0, "", 100) << std::endl;
+	std::string oneByte(1, '\x04');
+	std::cout << load_damaged(20, oneByte, 1000) << std::endl; // the element size
+	// rows = 2^61, rows * stride * 8 does not fit in a size_t
+	std::string hugeRows(8, '\0');
+	hugeRows[7] = '\x20';
+	std::cout << load_damaged(24, hugeRows, 1000) << std::endl;
+	// rows = 2^40 passes the size check, the stream is far too short for it
+	std::string manyRows(8, '\0');
+	manyRows[5] = '\x01';
+	std::cout << load_damaged(24, manyRows, 1000) << std::endl;
+	// stride below cols
+	std::string narrow(8, '\0');
+	narrow[0] = '\x02';
+	std::cout << load_damaged(40, narrow, 1000) << std::endl;
+
+	std::stringstream stream;
+	Save(random_matrix<double>(4, 5), stream);
+	try {
+		Load<float>(stream);
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &e) {
+		std::cout << e.what() << std::endl;
+	}
+	return 0;
+}
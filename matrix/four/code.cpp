@@ -0,0 +1,116 @@
+#include "class-matrix.hpp"
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+
+using namespace Diamond;
+
+Matrix<double> random_matrix(size_t rows, size_t cols) {
+	Matrix<double> a(rows, cols);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j)
+			a[i][j] = static_cast<double>(static_cast<int>(rand() % 2001) - 1000) / 100;
+	return a;
+}
+
+double norm(const Matrix<double> &a) {
+	double s = 0;
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < a.ColSize(); ++j)
+			s = std::max(s, std::fabs(a[i][j]));
+	return s;
+}
+
+// max |a - b| relative to the size of b
+bool close(const Matrix<double> &a, const Matrix<double> &b, double tolerance = 1e-9) {
+	Matrix<double> d = a - b;
+	return norm(d) <= tolerance * std::max(1.0, norm(b));
+}
+
+void test(const char *name) {
+	size_t sizes[] = {1, 2, 5, 17, 40, 100, 150};
+	bool lu = true, cholesky = true, qr = true;
+	for (size_t n : sizes) {
+		Matrix<double> a = random_matrix(n, n), b = random_matrix(n, 3);
+
+		LU<double> f(a);
+		Matrix<double> l(n, n, 0), u(n, n, 0), pa(n, n);
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j < n; ++j) {
+				if (j < i) l[i][j] = f.Factors()[i][j];
+				else u[i][j] = f.Factors()[i][j];
+				pa[i][j] = a[f.Permutation()[i]][j];
+			}
+			l[i][i] = 1;
+		}
+		lu = lu && !f.Singular() && close(l * u, pa) && close(a * f.Solve(b), b) && close(a * Inverse(a), I<double>(n), 1e-8);
+		// larger determinants overflow a double
+		if (n <= 17) lu = lu && std::fabs(Determinant(a * a) - Determinant(a) * Determinant(a)) <= 1e-8 * std::fabs(Determinant(a * a));
+
+		// symmetric positive definite: M M^T + n I
+		Matrix<double> m = random_matrix(n, n), s = m * Transpose(m);
+		for (size_t i = 0; i < n; ++i) s[i][i] += n;
+		Cholesky<double> c(s);
+		cholesky = cholesky && close(c.L() * Transpose(c.L()), s) && close(s * c.Solve(b), b);
+		if (n <= 17) cholesky = cholesky && std::fabs(c.Determinant() - Determinant(s)) <= 1e-8 * std::fabs(Determinant(s));
+
+		// square and tall
+		for (size_t rows : {n, n * 2 + 3}) {
+			Matrix<double> t = random_matrix(rows, n), y = random_matrix(rows, 2);
+			QR<double> q(t);
+			Matrix<double> qm = q.Q(), r = q.R();
+			qr = qr && close(Transpose(qm) * qm, I<double>(rows)) && close(qm * r, t);
+			for (size_t i = 0; i < rows; ++i)
+				for (size_t j = 0; j < std::min(i, n); ++j)
+					qr = qr && r[i][j] == 0;
+			// least squares: the residual is orthogonal to the columns of t
+			Matrix<double> x = q.Solve(y), residual = t * x - y;
+			qr = qr && close(Transpose(t) * residual, Matrix<double>(n, 2, 0), 1e-8 * norm(t) * norm(y));
+			if (rows == n) qr = qr && close(x, Solve(t, y), 1e-7);
+		}
+	}
+	std::cout << name << " " << lu << " " << cholesky << " " << qr << std::endl;
+}
+
+int main() {
+	test("default blocks");
+	LU<double>::block = 8;
+	Cholesky<double>::block = 8;
+	QR<double>::block = 4;
+	test("small blocks");
+	Parallel::threadCount = 3;
+	Parallel::grain = 1;
+	test("parallel");
+
+	// an integer matrix with a known determinant: unit lower times upper with 1..6 on the diagonal
+	Matrix<double> lower = I<double>(6), upper(6, 6, 0);
+	for (size_t i = 0; i < 6; ++i) {
+		for (size_t j = 0; j < i; ++j) lower[i][j] = static_cast<double>(rand() % 7) - 3;
+		for (size_t j = i; j < 6; ++j) upper[i][j] = j == i ? static_cast<double>(i + 1) : static_cast<double>(rand() % 7) - 3;
+	}
+	std::cout << std::llround(Determinant(lower * upper)) << " " << std::llround(Determinant(Matrix<double>(upper * lower * -1.0))) << std::endl;
+
+	Matrix<double> singular(3, 3, 1);
+	LU<double> f(singular);
+	std::cout << f.Singular() << " " << f.Determinant() << std::endl;
+	try {
+		f.Solve(Matrix<double>(3, 1, 1));
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "singular rejected" << std::endl;
+	}
+	try {
+		Matrix<double> negative = I<double>(4) * -1.0;
+		Cholesky<double> c(negative);
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "not positive definite rejected" << std::endl;
+	}
+	try {
+		LU<double> g(Matrix<double>(3, 4, 1));
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "non-square rejected" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "class-matrix.hpp"
+#include <cstdlib>
+#include <iostream>
+
+using namespace Diamond;
+
+// small integers, so every product and sum is exact in float and double too
+template<typename _Td>
+Matrix<_Td> random_matrix(size_t rows, size_t cols) {
+	Matrix<_Td> a(rows, cols);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j)
+			a[i][j] = static_cast<_Td>(static_cast<int>(rand() % 17) - 8);
+	return a;
+}
+
+template<typename _Td>
+Matrix<_Td> naive(const Matrix<_Td> &a, const Matrix<_Td> &b) {
+	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t p = 0; p < a.ColSize(); ++p)
+			for (size_t j = 0; j < b.ColSize(); ++j)
+				c[i][j] += a[i][p] * b[p][j];
+	return c;
+}
+
+template<typename _Td>
+long long checksum(const Matrix<_Td> &a) {
+	long long sum = 0;
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < a.ColSize(); ++j)
+			sum = ((sum * 31 + static_cast<long long>(a[i][j])) % 1000000007 + 1000000007) % 1000000007;
+	return sum;
+}
+
+template<typename _Td>
+void test(const char *name) {
+	// shapes straddling the micro-tile and the cutoff, and some larger than the blocks below
+	size_t shapes[][3] = {{1, 1, 1}, {5, 7, 3}, {6, 8, 16}, {7, 17, 9}, {13, 33, 31}, {17, 16, 17},
+		{50, 61, 70}, {97, 40, 130}, {128, 128, 128}};
+	size_t wrong = 0;
+	long long sum = 0;
+	for (auto &shape : shapes) {
+		Matrix<_Td> a = random_matrix<_Td>(shape[0], shape[2]), b = random_matrix<_Td>(shape[2], shape[1]);
+		Matrix<_Td> expected = naive(a, b);
+		wrong += !(a * b == expected);
+		// transposed operands are read through their strides
+		Matrix<_Td> at = Transpose(a), bt = Transpose(b);
+		wrong += !(Transpose(at) * b == expected);
+		wrong += !(a * Transpose(bt) == expected);
+		wrong += !(Transpose(at) * Transpose(bt) == expected);
+		// the destination may alias an operand
+		if (shape[0] == shape[2]) {
+			Matrix<_Td> c = a;
+			MultiplyInto(c, c, b);
+			wrong += !(c == expected);
+		}
+		sum = (sum * 7 + checksum(expected)) % 1000000007;
+	}
+	std::cout << name << " " << wrong << " " << sum << std::endl;
+}
+
+template<typename _Td>
+void test_blocks(const char *name) {
+	// blocks much smaller than the matrices, so every loop of the blocked product runs several times
+	size_t mc = Gemm<_Td>::mc, kc = Gemm<_Td>::kc, nc = Gemm<_Td>::nc;
+	Gemm<_Td>::mc = 12;
+	Gemm<_Td>::kc = 10;
+	Gemm<_Td>::nc = 48;
+	test<_Td>(name);
+	Gemm<_Td>::mc = mc;
+	Gemm<_Td>::kc = kc;
+	Gemm<_Td>::nc = nc;
+}
+
+int main() {
+	test<double>("double");
+	test<float>("float");
+	test<long long>("long long");
+	test<int>("int");
+	test_blocks<double>("double blocked");
+	test_blocks<float>("float blocked");
+	Parallel::threadCount = 3;
+	Parallel::grain = 1;
+	test<double>("double parallel");
+	test_blocks<float>("float blocked parallel");
+	try {
+		Matrix<double> a(3, 4), b(5, 2);
+		Matrix<double> c = a * b;
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "size mismatch rejected" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "class-matrix.hpp"
+#include <cstdlib>
+#include <iostream>
+
+using namespace Diamond;
+
+typedef long long ll;
+typedef unsigned long long ull;
+
+// rand() gives 31 random bits at a time, the entries are in (-2^bits, 2^bits)
+Matrix<ll> random_matrix(size_t rows, size_t cols, int bits, int zeros) {
+	Matrix<ll> a(rows, cols);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j) {
+			ll x = (static_cast<ll>(rand()) << 31 | rand()) & ((1LL << bits) - 1);
+			a[i][j] = rand() % 100 < zeros ? 0 : (rand() % 2 ? -x : x);
+		}
+	return a;
+}
+
+ll reduce(ll x, ll mod) {
+	ll r = x % mod;
+	return r < 0 ? r + mod : r;
+}
+
+// the naive products, c = a * b on the wrapping unsigned type or mod m on residues
+Matrix<ull> naive(const Matrix<ull> &a, const Matrix<ull> &b) {
+	Matrix<ull> c(a.RowSize(), b.ColSize(), 0);
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < b.ColSize(); ++j)
+			for (size_t p = 0; p < a.ColSize(); ++p)
+				c[i][j] += a[i][p] * b[p][j];
+	return c;
+}
+
+Matrix<ll> naive_mod(const Matrix<ll> &a, const Matrix<ll> &b, ll mod) {
+	Matrix<ll> c(a.RowSize(), b.ColSize(), 0);
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < b.ColSize(); ++j)
+			for (size_t p = 0; p < a.ColSize(); ++p)
+				c[i][j] = static_cast<ll>((static_cast<__int128>(reduce(a[i][p], mod)) * reduce(b[p][j], mod) + c[i][j]) % mod);
+	return c;
+}
+
+Matrix<ll> identity_mod(size_t n, ll mod) {
+	Matrix<ll> e(n, n, 0);
+	for (size_t i = 0; i < n; ++i) e[i][i] = 1 % mod;
+	return e;
+}
+
+// A^b for b = 0 .. 40 against repeated naive products, exact on the wrapping unsigned type
+template<typename _Td>
+int test_pow(const Matrix<_Td> &a) {
+	int wrong = 0;
+	MatrixPower<_Td> power(a);
+	Matrix<_Td> expected = I<_Td>(a.RowSize());
+	for (size_t b = 0; b <= 40; ++b) {
+		wrong += !(Pow(a, b) == expected) + !(power(b) == expected);
+		Matrix<_Td> next(a.RowSize(), a.ColSize(), 0);
+		for (size_t i = 0; i < a.RowSize(); ++i)
+			for (size_t j = 0; j < a.ColSize(); ++j)
+				for (size_t p = 0; p < a.ColSize(); ++p)
+					next[i][j] += expected[i][p] * a[p][j];
+		expected = next;
+	}
+	return wrong;
+}
+
+// PowMod, MatrixPower and MultiplyMod under one modulus, the entries are left unreduced
+int test_mod(size_t n, ll mod, int bits, int zeros) {
+	int wrong = 0;
+	Matrix<ll> a = random_matrix(n, n, bits, zeros);
+	MatrixPower<ll> power(a, mod);
+	Matrix<ll> expected = identity_mod(n, mod);
+	for (size_t b = 0; b <= 40; ++b) {
+		wrong += !(PowMod(a, b, mod) == expected) + !(power(b) == expected);
+		expected = naive_mod(expected, a, mod);
+	}
+	// a large exponent, the Cayley-Hamilton path and the cached squares must agree with PowMod
+	size_t big = 1000000000039ULL;
+	Matrix<ll> far = PowMod(a, big, mod);
+	wrong += !(power(big) == far);
+	wrong += !(naive_mod(far, a, mod) == PowMod(a, big + 1, mod));
+	Matrix<ll> x = random_matrix(n, n + 3, bits, zeros), y = random_matrix(n + 3, 2, bits, zeros), z;
+	wrong += !(MultiplyMod(z, x, y, mod) == naive_mod(x, y, mod));
+	std::cout << n << " " << mod << " " << wrong << " " << far[0][n - 1] << std::endl;
+	return wrong;
+}
+
+int main() {
+	// plain powers, wrapping unsigned entries and small signed ones that cannot overflow
+	for (size_t n : {1, 2, 3, 5, 8}) {
+		Matrix<ull> a(n, n);
+		for (size_t i = 0; i < n; ++i)
+			for (size_t j = 0; j < n; ++j)
+				a[i][j] = static_cast<ull>(rand()) << 33 | rand();
+		std::cout << "pow " << n << " " << test_pow(a) << std::endl;
+	}
+	Matrix<ll> fib(2, 2, 1), signs(2, 2);
+	fib[1][1] = 0;
+	for (int i = 0; i < 4; ++i) signs[i / 2][i % 2] = rand() % 3 - 1;
+	std::cout << "pow signed " << test_pow(fib) << " " << test_pow(signs) << " " << Pow(fib, 40)[0][1] << std::endl;
+
+	// 1, composite moduli, small primes that take the Hessenberg path, and moduli above 2^32
+	ll moduli[] = {1, 2, 1000000, 97, 998244353, 4294967291LL, 4294967296LL, 1000000000000000003LL, 4611686018427387903LL};
+	int wrong = 0;
+	for (ll mod : moduli)
+		for (size_t n : {1, 2, 5, 17})
+			wrong += test_mod(n, mod, 62, n == 17 ? 70 : 20);
+	// sparse matrices need the row swaps of the Hessenberg reduction
+	for (size_t n : {6, 11, 30})
+		wrong += test_mod(n, 1000000007, 20, 85);
+	std::cout << "wrong " << wrong << std::endl;
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include "class-fixed-matrix.hpp"
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+
+using namespace Diamond;
+
+// everything is usable in constant expressions
+constexpr FixedMatrix<int, 2, 3> A{1, 2, 3, 4, 5, 6};
+constexpr FixedMatrix<int, 3, 2> B{7, 8, 9, 10, 11, 12};
+static_assert((A * B)[1][1] == 154, "constexpr product");
+static_assert(Trace(A * B) == 58 + 154, "constexpr trace");
+static_assert(Transpose(A) == FixedMatrix<int, 3, 2>{1, 4, 2, 5, 3, 6}, "constexpr transpose");
+static_assert(Determinant(FixedMatrix<int, 3, 3>{2, 0, 1, 1, 3, 2, 1, 1, 2}) == 6, "constexpr determinant");
+static_assert(Inverse(FixedMatrix<double, 2, 2>{2, 1, 0, 4})[0][0] == 0.5, "constexpr inverse");
+
+template<size_t R, size_t C>
+FixedMatrix<double, R, C> random_fixed() {
+	FixedMatrix<double, R, C> a;
+	for (size_t i = 0; i < R; ++i)
+		for (size_t j = 0; j < C; ++j)
+			a[i][j] = static_cast<double>(static_cast<int>(rand() % 201) - 100) / 10;
+	return a;
+}
+
+template<size_t R, size_t C>
+double distance(const FixedMatrix<double, R, C> &a, const FixedMatrix<double, R, C> &b) {
+	double d = 0;
+	for (size_t i = 0; i < R; ++i)
+		for (size_t j = 0; j < C; ++j)
+			d = std::max(d, std::fabs(a[i][j] - b[i][j]));
+	return d;
+}
+
+// closed forms up to 4 x 4 and elimination above, checked against the dynamic Matrix
+template<size_t N>
+bool test_square() {
+	bool ok = true;
+	for (int round = 0; round < 50; ++round) {
+		FixedMatrix<double, N, N> a = random_fixed<N, N>(), b = random_fixed<N, N>();
+		Matrix<double> da = a.ToMatrix(), db = b.ToMatrix();
+		ok = ok && FixedMatrix<double, N, N>(da * db) == a * b;
+		ok = ok && FixedMatrix<double, N, N>(Matrix<double>(Transpose(da))) == Transpose(a);
+		double det = Determinant(a);
+		ok = ok && std::fabs(det - Determinant(da)) <= 1e-9 * std::max(1.0, std::fabs(det));
+		if (std::fabs(det) > 1e-3) {
+			ok = ok && distance(a * Inverse(a), FixedMatrix<double, N, N>::Identity()) < 1e-8;
+		}
+	}
+	return ok;
+}
+
+template<size_t R, size_t K, size_t C>
+bool test_product() {
+	FixedMatrix<double, R, K> a = random_fixed<R, K>();
+	FixedMatrix<double, K, C> b = random_fixed<K, C>();
+	FixedMatrix<double, R, C> c = a * b;
+	Matrix<double> expected = a.ToMatrix() * b.ToMatrix();
+	return distance(c, FixedMatrix<double, R, C>(expected)) == 0 && c.RowSize() == R && c.ColSize() == C;
+}
+
+int main() {
+	std::cout << test_square<1>() << test_square<2>() << test_square<3>() << test_square<4>()
+		<< test_square<5>() << test_square<6>() << test_square<9>() << std::endl;
+	std::cout << test_product<1, 7, 3>() << test_product<3, 4, 2>() << test_product<8, 8, 8>()
+		<< test_product<5, 1, 6>() << std::endl;
+
+	FixedMatrix<double, 3, 3> m{1, 2, 3, 0, 1, 4, 5, 6, 0};
+	FixedMatrix<double, 3, 3> inverse = Inverse(m);
+	std::cout << Determinant(m) << " " << Trace(m) << " " << inverse[0][0] << " " << inverse[2][2] << std::endl;
+	FixedMatrix<int, 2, 3> c = A * 2 - FixedMatrix<int, 2, 3>(1);
+	c += -A / 2;
+	c *= 3;
+	std::cout << c[0][0] << " " << c[1][2] << " " << (c != A) << std::endl;
+
+	try {
+		Inverse(FixedMatrix<double, 3, 3>{1, 2, 3, 2, 4, 6, 0, 0, 1});
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "singular rejected" << std::endl;
+	}
+	try {
+		Inverse(FixedMatrix<double, 5, 5>());
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "singular rejected" << std::endl;
+	}
+	try {
+		FixedMatrix<int, 2, 2> tooMany{1, 2, 3, 4, 5};
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "too many elements rejected" << std::endl;
+	}
+	try {
+		FixedMatrix<double, 2, 2> wrongSize{Matrix<double>(2, 3)};
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "size mismatch rejected" << std::endl;
+	}
+	return 0;
+}
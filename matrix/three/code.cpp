@@ -0,0 +1,112 @@
+#include "class-sparse-matrix.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace Diamond;
+
+typedef SparseMatrix<long long> sparse_t;
+
+// about density per mille of the positions, with repeated positions to be summed
+std::vector<sparse_t::Triplet> random_triplets(size_t rows, size_t cols, size_t density) {
+	std::vector<sparse_t::Triplet> triplets;
+	size_t count = rows * cols * density / 1000 + 1;
+	for (size_t t = 0; t < count; ++t) {
+		sparse_t::Triplet e = {rand() % rows, rand() % cols, static_cast<long long>(rand() % 19) - 9};
+		triplets.push_back(e);
+		if (rand() % 4 == 0) triplets.push_back(e);
+	}
+	return triplets;
+}
+
+Matrix<long long> dense_of(size_t rows, size_t cols, const std::vector<sparse_t::Triplet> &triplets) {
+	Matrix<long long> a(rows, cols, 0);
+	for (auto &e : triplets) a[e.row][e.col] += e.value;
+	return a;
+}
+
+Matrix<long long> naive(const Matrix<long long> &a, const Matrix<long long> &b) {
+	Matrix<long long> c(a.RowSize(), b.ColSize(), 0);
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t p = 0; p < a.ColSize(); ++p)
+			for (size_t j = 0; j < b.ColSize(); ++j)
+				c[i][j] += a[i][p] * b[p][j];
+	return c;
+}
+
+// the runs must be sorted and free of repeated indices
+bool well_formed(const sparse_t &a) {
+	size_t major = a.Layout() == sparse_t::CSR ? a.RowSize() : a.ColSize();
+	if (a.Ptr().size() != major + 1 || a.Ptr()[major] != a.NonZeros()) return false;
+	for (size_t m = 0; m < major; ++m)
+		for (size_t t = a.Ptr()[m] + 1; t < a.Ptr()[m + 1]; ++t)
+			if (a.Indices()[t - 1] >= a.Indices()[t]) return false;
+	return true;
+}
+
+long long checksum(const Matrix<long long> &a) {
+	long long sum = 0;
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < a.ColSize(); ++j)
+			sum = ((sum * 31 + a[i][j]) % 1000000007 + 1000000007) % 1000000007;
+	return sum;
+}
+
+void test(const char *name) {
+	size_t shapes[][4] = {{1, 1, 1, 1000}, {7, 5, 9, 300}, {40, 60, 30, 50}, {120, 90, 150, 20}, {300, 200, 250, 5}};
+	size_t wrong = 0;
+	long long sum = 0;
+	for (auto &shape : shapes) {
+		size_t m = shape[0], k = shape[1], n = shape[2], density = shape[3];
+		std::vector<sparse_t::Triplet> ta = random_triplets(m, k, density), tb = random_triplets(k, n, density);
+		Matrix<long long> da = dense_of(m, k, ta), db = dense_of(k, n, tb);
+		Matrix<long long> expected = naive(da, db);
+		std::vector<long long> x(k);
+		for (auto &v : x) v = static_cast<long long>(rand() % 11) - 5;
+		std::vector<long long> y(m, 0);
+		for (size_t i = 0; i < m; ++i)
+			for (size_t p = 0; p < k; ++p)
+				y[i] += da[i][p] * x[p];
+		for (int fa = 0; fa < 2; ++fa) {
+			for (int fb = 0; fb < 2; ++fb) {
+				sparse_t a(m, k, ta, fa ? sparse_t::CSC : sparse_t::CSR), b(k, n, tb, fb ? sparse_t::CSC : sparse_t::CSR);
+				wrong += !well_formed(a) || !well_formed(b);
+				wrong += !(a.ToDense() == da) || !(b.ToDense() == db);
+				wrong += !(a * db == expected);
+				wrong += !(da * b == expected);
+				sparse_t c = a * b;
+				wrong += !well_formed(c) || !(c.ToDense() == expected);
+				wrong += !(Transpose((Transpose(b) * Transpose(a)).ToDense()) == expected);
+				// a temporary is transposed in place of its arrays
+				const long long *values = c.Values().data();
+				sparse_t t = Transpose(std::move(c));
+				wrong += !well_formed(t) || !(Transpose(t.ToDense()) == expected) || t.Values().data() != values;
+			}
+			sparse_t a(m, k, ta, fa ? sparse_t::CSC : sparse_t::CSR);
+			wrong += !(a * x == y);
+			sparse_t other = a.Convert(fa ? sparse_t::CSR : sparse_t::CSC);
+			wrong += !well_formed(other) || !(other.ToDense() == da) || !(sparse_t(other.ToDense()).ToDense() == da);
+			for (int probe = 0; probe < 20; ++probe) {
+				size_t i = rand() % m, j = rand() % k;
+				wrong += a.At(i, j) != da[i][j];
+			}
+		}
+		sum = (sum * 7 + checksum(expected)) % 1000000007;
+	}
+	std::cout << name << " " << wrong << " " << sum << std::endl;
+}
+
+int main() {
+	test("serial");
+	Parallel::threadCount = 3;
+	Parallel::grain = 1;
+	test("parallel");
+	try {
+		sparse_t a(3, 4), b(5, 2);
+		sparse_t c = a * b;
+		std::cout << "no throw" << std::endl;
+	} catch (std::invalid_argument &) {
+		std::cout << "size mismatch rejected" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include "class-matrix.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace Diamond;
+
+template<typename _Td>
+_Td make(unsigned long long x) {
+	return static_cast<_Td>(x % 100003);
+}
+
+template<>
+std::string make<std::string>(unsigned long long x) {
+	return std::to_string(x % 100003);
+}
+
+template<typename _Td>
+Matrix<_Td> random_matrix(size_t rows, size_t cols) {
+	Matrix<_Td> a(rows, cols);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j)
+			a[i][j] = make<_Td>(rand());
+	return a;
+}
+
+template<typename _Td>
+bool is_transpose(const Matrix<_Td> &t, const Matrix<_Td> &a) {
+	if (t.RowSize() != a.ColSize() || t.ColSize() != a.RowSize()) return false;
+	for (size_t i = 0; i < a.RowSize(); ++i)
+		for (size_t j = 0; j < a.ColSize(); ++j)
+			if (!(t[j][i] == a[i][j])) return false;
+	return true;
+}
+
+template<typename _Td>
+void test(const char *name) {
+	// sizes below, at and across the register blocks and the 32 x 32 tiles
+	size_t shapes[][2] = {{1, 1}, {1, 9}, {3, 5}, {4, 8}, {8, 4}, {16, 8}, {17, 33}, {31, 31}, {32, 32},
+		{33, 33}, {64, 64}, {65, 70}, {100, 37}, {129, 129}};
+	size_t wrong = 0;
+	for (auto &shape : shapes) {
+		Matrix<_Td> a = random_matrix<_Td>(shape[0], shape[1]);
+		Matrix<_Td> t = Transpose(a);
+		wrong += !is_transpose(t, a);
+		// into a matrix that already has the right shape
+		Matrix<_Td> u(shape[1], shape[0]);
+		u = Transpose(a);
+		wrong += !is_transpose(u, a);
+		// in place, square or not
+		Matrix<_Td> b = a;
+		b.TransposeInPlace();
+		wrong += !is_transpose(b, a);
+		b = Transpose(b);
+		wrong += !(b == a);
+	}
+	std::cout << name << " " << wrong << std::endl;
+}
+
+int main() {
+	test<double>("double");
+	test<float>("float");
+	test<long long>("long long");
+	test<int>("int");
+	test<short>("short");
+	test<std::string>("string");
+	// every result large enough for streaming stores
+	Transposer<double>::streamBytes = 0;
+	Transposer<float>::streamBytes = 0;
+	test<double>("double streamed");
+	test<float>("float streamed");
+	Parallel::threadCount = 3;
+	Parallel::grain = 1;
+	test<double>("double parallel");
+	test<float>("float parallel");
+	test<std::string>("string parallel");
+	return 0;
+}
@@ -0,0 +1,464 @@
+#ifndef SJTU_PERSISTENT_MAP_HPP
+#define SJTU_PERSISTENT_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * a copy-on-write red-black tree.
+ * nodes are reference counted and never changed once they are shared,
+ *   insert and erase copy the path they walk (and the siblings they recolor),
+ *   so taking a snapshot is O(1) and a snapshot never changes.
+ * there is no threading and no father link, iterators keep a stack of ancestors instead.
+ *
+ * one writer may modify the map while any number of readers take snapshots and
+ *   iterate them without locking; only reading and publishing the root is locked.
+ */
+template <class Key, class T, class Compare = std::less<Key>>
+class persistent_map {
+public:
+	typedef pair<const Key, T> value_type;
+	class const_iterator;
+	class snapshot_type;
+private:
+	struct __rbt_node {
+		enum color_t {
+			RED, BLACK
+		};
+
+		std::atomic<size_t> refs;
+		color_t color;
+		__rbt_node *child[2];
+		value_type value;
+
+		__rbt_node(const value_type &value) : refs(1), color(RED), value(value) {
+			child[LEFT] = child[RIGHT] = nullptr;
+		}
+		__rbt_node(const __rbt_node &other) : refs(1), color(other.color), value(other.value) { // the copy shares the children
+			child[LEFT] = other.child[LEFT];
+			child[RIGHT] = other.child[RIGHT];
+			if (child[LEFT] != nullptr) ++child[LEFT]->refs;
+			if (child[RIGHT] != nullptr) ++child[RIGHT]->refs;
+		}
+	};
+
+	typedef __rbt_node* link_type;
+	typedef bool which_type;
+
+	static constexpr which_type LEFT = false;
+	static constexpr which_type RIGHT = true;
+	static constexpr typename __rbt_node::color_t RED = __rbt_node::RED;
+	static constexpr typename __rbt_node::color_t BLACK = __rbt_node::BLACK;
+	static constexpr size_t MAX_DEPTH = 128; // the height of a red-black tree is below 2 log(n + 1)
+
+	link_type root;
+	size_t __size;
+	Compare compare;
+	mutable std::mutex publish_lock; // guards root and __size against snapshot()
+
+	static void acquire(link_type x) {
+		if (x != nullptr) ++x->refs;
+	}
+	static void release(link_type x) {
+		while (x != nullptr && --x->refs == 0) {
+			release(x->child[LEFT]);
+			link_type next = x->child[RIGHT];
+			delete x;
+			x = next;
+		}
+	}
+	static bool is_red(link_type x) {
+		return x != nullptr && x->color == RED;
+	}
+	/**
+	 * the path from the private copy of the root to the current node.
+	 * path[i] is the which[i] child of path[i - 1].
+	 */
+	struct path_type {
+		link_type root;
+		link_type node[MAX_DEPTH];
+		which_type which[MAX_DEPTH];
+
+		link_type &slot(size_t depth) {
+			return depth == 0 ? root : node[depth - 1]->child[which[depth]];
+		}
+	};
+
+	// make parent->child[which] private to the writer, parent must be private already
+	static link_type own(link_type parent, which_type which) {
+		link_type x = parent->child[which];
+		if (x == nullptr || x->refs == 1) return x;
+		link_type copied = new __rbt_node(*x);
+		release(x);
+		return parent->child[which] = copied;
+	}
+	static link_type own(path_type &path, size_t depth) {
+		if (depth > 0) return own(path.node[depth - 1], path.which[depth]);
+		link_type x = path.root;
+		if (x == nullptr || x->refs == 1) return x;
+		path.root = new __rbt_node(*x);
+		release(x);
+		return path.root;
+	}
+	static link_type rotate(link_type x, which_type which) { // x goes down to the which side
+		link_type y = x->child[which ^ 1];
+		x->child[which ^ 1] = y->child[which];
+		y->child[which] = x;
+		return y;
+	}
+	static link_type find_node(link_type cur, const Key &key, const Compare &compare) {
+		while (cur != nullptr) {
+			if (compare(key, cur->value.first))
+				cur = cur->child[LEFT];
+			else if (compare(cur->value.first, key))
+				cur = cur->child[RIGHT];
+			else
+				return cur;
+		}
+		return nullptr;
+	}
+
+	void publish(link_type new_root, size_t new_size) {
+		link_type old_root;
+		{
+			std::lock_guard<std::mutex> guard(publish_lock);
+			old_root = root;
+			root = new_root;
+			__size = new_size;
+		}
+		release(old_root);
+	}
+
+	void insert_rebalance(path_type &path, size_t depth) {
+		while (depth >= 2 && path.node[depth - 1]->color == RED) {
+			link_type father = path.node[depth - 1], grandfather = path.node[depth - 2];
+			which_type side = path.which[depth - 1];
+			if (is_red(grandfather->child[side ^ 1])) {
+				link_type uncle = own(grandfather, side ^ 1);
+				father->color = uncle->color = BLACK;
+				grandfather->color = RED;
+				depth -= 2;
+				continue;
+			}
+			if (path.which[depth] != side) {
+				grandfather->child[side] = rotate(father, side);
+				father = grandfather->child[side];
+			}
+			father->color = BLACK;
+			grandfather->color = RED;
+			path.slot(depth - 2) = rotate(grandfather, side ^ 1);
+			break;
+		}
+		path.root->color = BLACK;
+	}
+
+	// the subtree at depth lost one black node
+	void erase_rebalance(path_type &path, size_t depth) {
+		while (true) {
+			if (is_red(path.slot(depth))) {
+				own(path, depth)->color = BLACK;
+				return;
+			}
+			if (depth == 0) return;
+			link_type father = path.node[depth - 1];
+			which_type side = path.which[depth];
+			link_type brother = own(father, side ^ 1);
+			if (brother->color == RED) {
+				brother->color = BLACK;
+				father->color = RED;
+				path.slot(depth - 1) = rotate(father, side);
+				path.node[depth - 1] = brother;
+				path.node[depth] = father;
+				path.which[depth] = side;
+				++depth;
+				path.which[depth] = side;
+				brother = own(father, side ^ 1);
+			}
+			if (!is_red(brother->child[LEFT]) && !is_red(brother->child[RIGHT])) {
+				brother->color = RED;
+				--depth;
+				continue;
+			}
+			if (!is_red(brother->child[side ^ 1])) {
+				link_type nephew = own(brother, side);
+				nephew->color = BLACK;
+				brother->color = RED;
+				brother = father->child[side ^ 1] = rotate(brother, side ^ 1);
+			}
+			link_type nephew = own(brother, side ^ 1);
+			brother->color = father->color;
+			father->color = BLACK;
+			nephew->color = BLACK;
+			path.slot(depth - 1) = rotate(father, side);
+			return;
+		}
+	}
+
+	// copy the root and walk down to key, return the depth of the node or of the empty slot for key
+	size_t descend(path_type &path, const Key &key, bool &found) {
+		path.root = root == nullptr ? nullptr : new __rbt_node(*root);
+		found = false;
+		size_t depth = 0;
+		link_type cur = path.root;
+		while (cur != nullptr) {
+			path.node[depth] = cur;
+			which_type which = compare(cur->value.first, key);
+			if (!which && !compare(key, cur->value.first)) {
+				found = true;
+				return depth;
+			}
+			cur = own(cur, which);
+			path.which[++depth] = which;
+		}
+		return depth;
+	}
+
+	bool __insert(const value_type &value, bool assign) {
+		if (!assign && find_node(root, value.first, compare) != nullptr) return false;
+		path_type path;
+		bool found;
+		size_t depth = descend(path, value.first, found);
+		if (found) {
+			path.node[depth]->value.second = value.second;
+			publish(path.root, __size);
+			return false;
+		}
+		link_type x = new __rbt_node(value);
+		path.slot(depth) = x;
+		path.node[depth] = x;
+		insert_rebalance(path, depth);
+		publish(path.root, __size + 1);
+		return true;
+	}
+public:
+	persistent_map() : root(nullptr), __size(0), compare() {}
+	persistent_map(const persistent_map &other) : compare(other.compare) { // O(1), the tree is shared
+		std::lock_guard<std::mutex> guard(other.publish_lock);
+		root = other.root;
+		__size = other.__size;
+		acquire(root);
+	}
+	persistent_map &operator=(const persistent_map &other) {
+		if (this == &other) return *this;
+		link_type new_root;
+		size_t new_size;
+		{
+			std::lock_guard<std::mutex> guard(other.publish_lock);
+			new_root = other.root;
+			new_size = other.__size;
+			acquire(new_root);
+		}
+		publish(new_root, new_size);
+		return *this;
+	}
+	~persistent_map() {
+		release(root);
+	}
+
+	/**
+	 * take a frozen version in O(1), safe to call while the writer is working.
+	 */
+	snapshot_type snapshot() const {
+		std::lock_guard<std::mutex> guard(publish_lock);
+		acquire(root);
+		return snapshot_type(root, __size, compare);
+	}
+
+	/**
+	 * the following reading functions are for the writer,
+	 *   readers on other threads should take a snapshot.
+	 */
+	bool empty() const {
+		return __size == 0;
+	}
+	size_t size() const {
+		return __size;
+	}
+	size_t count(const Key &key) const {
+		return find_node(root, key, compare) == nullptr ? 0 : 1;
+	}
+	const T & at(const Key &key) const {
+		link_type x = find_node(root, key, compare);
+		if (x == nullptr) throw index_out_of_bound();
+		return x->value.second;
+	}
+	const_iterator cbegin() const {
+		return const_iterator(root);
+	}
+	const_iterator cend() const {
+		return const_iterator();
+	}
+
+	/**
+	 * insert value if the key does not exist, return true if inserted.
+	 */
+	bool insert(const value_type &value) {
+		return __insert(value, false);
+	}
+	/**
+	 * insert value, or overwrite the mapped value if the key exists.
+	 * return true if inserted.
+	 */
+	bool insert_or_assign(const Key &key, const T &value) {
+		return __insert(value_type(key, value), true);
+	}
+	/**
+	 * erase the element with key, return the number of elements erased.
+	 */
+	size_t erase(const Key &key) {
+		if (find_node(root, key, compare) == nullptr) return 0;
+		path_type path;
+		bool found;
+		size_t depth = descend(path, key, found);
+		link_type target = path.node[depth];
+		if (target->child[LEFT] != nullptr && target->child[RIGHT] != nullptr) {
+			// swap target with its successor, both are private after own()
+			size_t target_depth = depth;
+			link_type successor = own(target, RIGHT);
+			path.which[++depth] = RIGHT;
+			while (successor->child[LEFT] != nullptr) {
+				path.node[depth] = successor;
+				successor = own(successor, LEFT);
+				path.which[++depth] = LEFT;
+			}
+			link_type successor_right = successor->child[RIGHT];
+			successor->child[LEFT] = target->child[LEFT];
+			if (depth == target_depth + 1) {
+				successor->child[RIGHT] = target;
+			} else {
+				successor->child[RIGHT] = target->child[RIGHT];
+				path.node[depth - 1]->child[LEFT] = target;
+			}
+			target->child[LEFT] = nullptr;
+			target->child[RIGHT] = successor_right;
+			path.slot(target_depth) = successor;
+			path.node[target_depth] = successor;
+			path.node[depth] = target;
+			typename __rbt_node::color_t color = successor->color;
+			successor->color = target->color;
+			target->color = color;
+		}
+		link_type child = target->child[target->child[LEFT] == nullptr];
+		path.slot(depth) = child;
+		target->child[LEFT] = target->child[RIGHT] = nullptr;
+		if (target->color == BLACK) erase_rebalance(path, depth);
+		release(target);
+		publish(path.root, __size - 1);
+		return 1;
+	}
+	void clear() {
+		publish(nullptr, 0);
+	}
+
+public:
+	/**
+	 * a frozen version of the map, holding a reference to its root.
+	 */
+	class snapshot_type {
+		friend class persistent_map;
+	private:
+		link_type root;
+		size_t __size;
+		Compare compare;
+		snapshot_type(link_type root, size_t size, const Compare &compare) : root(root), __size(size), compare(compare) {}
+	public:
+		snapshot_type() : root(nullptr), __size(0), compare() {}
+		snapshot_type(const snapshot_type &other) : root(other.root), __size(other.__size), compare(other.compare) {
+			acquire(root);
+		}
+		snapshot_type &operator=(const snapshot_type &other) {
+			acquire(other.root);
+			release(root);
+			root = other.root;
+			__size = other.__size;
+			compare = other.compare;
+			return *this;
+		}
+		~snapshot_type() {
+			release(root);
+		}
+
+		bool empty() const {
+			return __size == 0;
+		}
+		size_t size() const {
+			return __size;
+		}
+		size_t count(const Key &key) const {
+			return find_node(root, key, compare) == nullptr ? 0 : 1;
+		}
+		const T & at(const Key &key) const {
+			link_type x = find_node(root, key, compare);
+			if (x == nullptr) throw index_out_of_bound();
+			return x->value.second;
+		}
+		const_iterator cbegin() const {
+			return const_iterator(root);
+		}
+		const_iterator cend() const {
+			return const_iterator();
+		}
+	};
+
+	/**
+	 * an in-order iterator keeping the stack of the ancestors it has to come back to.
+	 * it is valid as long as the snapshot (or the version of the map) it comes from.
+	 */
+	class const_iterator {
+		friend class persistent_map;
+	public:
+		typedef const value_type value;
+		typedef const value_type * pointer;
+		typedef const value_type & reference;
+	private:
+		const __rbt_node *stack[MAX_DEPTH];
+		size_t top;
+
+		void push_leftmost(const __rbt_node *x) {
+			for (; x != nullptr; x = x->child[LEFT])
+				stack[top++] = x;
+		}
+		explicit const_iterator(const __rbt_node *root) : top(0) {
+			push_leftmost(root);
+		}
+	public:
+		const_iterator() : top(0) {}
+
+		const_iterator & operator++() {
+			if (top == 0) throw invalid_iterator();
+			const __rbt_node *x = stack[--top];
+			push_leftmost(x->child[RIGHT]);
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator backup(*this);
+			operator++();
+			return backup;
+		}
+		reference operator*() const {
+			return *operator->();
+		}
+		pointer operator->() const {
+			if (top == 0) throw invalid_iterator();
+			return &stack[top - 1]->value;
+		}
+
+		bool operator==(const const_iterator &rhs) const {
+			if (top == 0 || rhs.top == 0) return top == rhs.top;
+			return stack[top - 1] == rhs.stack[rhs.top - 1];
+		}
+		bool operator!=(const const_iterator &rhs) const {
+			return !operator==(rhs);
+		}
+	};
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include "persistent_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <cassert>
+#include <string>
+
+typedef sjtu::persistent_map<int, std::string> map_t;
+
+void print(const map_t::snapshot_type &snapshot) {
+	long long checksum = 0;
+	int counter = 0, last = -1;
+	for (map_t::const_iterator it = snapshot.cbegin(); it != snapshot.cend(); ++it) {
+		assert(it->first > last);
+		last = it->first;
+		checksum = (checksum * 131 + it->first + it->second.length()) % 1000000007;
+		if ((++counter) % 211 == 0) std::cout << it->first << ":" << it->second << " ";
+	}
+	assert(static_cast<size_t>(counter) == snapshot.size());
+	std::cout << snapshot.size() << " " << checksum << std::endl;
+}
+
+int main() {
+	map_t map;
+	map_t::snapshot_type versions[10];
+	for (int time = 0; time < 10; ++time) {
+		for (int i = 0; i < 20000; ++i) {
+			int key = rand() % 10000;
+			switch (rand() % 4) {
+			case 0:
+			case 1:
+				map.insert(map_t::value_type(key, std::to_string(i)));
+				break;
+			case 2:
+				map.insert_or_assign(key, std::to_string(-i));
+				break;
+			default:
+				map.erase(key);
+			}
+		}
+		versions[time] = map.snapshot();
+		print(versions[time]);
+	}
+	// old versions never change
+	for (int time = 0; time < 10; ++time) print(versions[time]);
+	map_t copy(map);
+	map.clear();
+	assert(map.empty() && map.cbegin() == map.cend());
+	print(map.snapshot());
+	print(copy.snapshot());
+	std::cout << copy.at(versions[9].cbegin()->first) << " " << copy.count(-1) << std::endl;
+	try {
+		copy.at(-1);
+	} catch (...) {
+		std::cout << "exception" << std::endl;
+	}
+	return 0;
+}